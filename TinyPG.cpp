@@ -8,6 +8,21 @@
 #include <QDateTime>
 #include <QUuid>
 #include <QtGlobal>
+#include <QLocale>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QTemporaryFile>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <cmath>
+#include <atomic>
+#include <cstring>
+#include <charconv>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace TinyPG
 {
@@ -44,6 +59,26 @@ QDebug operator << (QDebug debug, const Message &error)
     return debug;
 }
 
+struct Result::Data
+{
+    QVector<Field> fields;
+    QHash<QString, int> names;
+    QVector<char *> rows;
+    QVector<qint64> spillRows;
+    QByteArray tag;
+
+    QTemporaryFile * spill = nullptr;
+    uchar * map = nullptr;
+    int mapped = 0;
+
+    ~Data();
+
+    int size() const;
+    const char * row(int index) const;
+    void finish();
+    void clearRows();
+};
+
 //Connection==============================================================================================
 //========================================================================================================
 
@@ -58,7 +93,7 @@ QDebug operator << (QDebug debug, const Message &error)
 #define _TIMETZOID 1266
 #define _TIMESTAMPOID 1114
 #define _TIMESTAMPTZOID 1184
-#define _OIDOID 2278
+#define _OIDOID 26
 #define _BYTEAOID 17
 #define _REGPROCOID 24
 #define _XIDOID 28
@@ -67,6 +102,25 @@ QDebug operator << (QDebug debug, const Message &error)
 #define _VARCHAROID 1043
 #define _TEXTOID 25
 #define _UUIDOID 2950
+#define _NUMERICOID 1700
+#define _JSONOID 114
+#define _JSONBOID 3802
+#define _BOOLARRAYOID 1000
+#define _BYTEAARRAYOID 1001
+#define _CHARARRAYOID 1002
+#define _INT2ARRAYOID 1005
+#define _INT4ARRAYOID 1007
+#define _TEXTARRAYOID 1009
+#define _VARCHARARRAYOID 1015
+#define _INT8ARRAYOID 1016
+#define _FLOAT4ARRAYOID 1021
+#define _FLOAT8ARRAYOID 1022
+#define _TIMESTAMPARRAYOID 1115
+#define _DATEARRAYOID 1182
+#define _TIMEARRAYOID 1183
+#define _TIMESTAMPTZARRAYOID 1185
+#define _UUIDARRAYOID 2951
+#define _NUMERICARRAYOID 1231
 
 #define NegotiateProtocolVersion 0x76
 #define ErrorResponse 0x45
@@ -93,9 +147,31 @@ QDebug operator << (QDebug debug, const Message &error)
 #define NoData 0x6e
 #define CommandCompletion 0x43
 #define EmptyQueryResponse 0x49
+#define SimpleQuery 0x51
 #define Describe 0x44
 #define Statement 0x53
+#define Portal 0x50
+#define Execute 0x45
+#define Flush 0x48
+#define Close 0x43
+#define Sync 0x53
+#define PortalSuspended 0x73
+#define CloseComplete 0x33
+#define ExecuteSyncSize 15
+#define PortalNone 0
+#define PortalActive 1
+#define PortalHeld 2
+#define CancelRequestCode 80877102
+#define DescriptionCacheSize 256
+#define PostgresEpochDays 2451545
+#define PostgresEpochMSecs Q_INT64_C(946684800000)
+#define PostgresEpochUSecs Q_INT64_C(946684800000000)
+#define ExportChunkSize 0x10000
+#define ParallelMinimumRows 4096
 #define ParameterDescription 0x74
+#define CopyBothResponse 0x57
+#define CopyData 0x64
+#define CopyDone 0x63
 
 static constexpr std::initializer_list<std::size_t> BOOL = {_BOOLOID};
 static constexpr std::initializer_list<std::size_t> INT2 = {_INT2OID};
@@ -110,11 +186,50 @@ static constexpr std::initializer_list<std::size_t> TIMESTAMP = {_TIMESTAMPOID,
 static constexpr std::initializer_list<std::size_t> BYTEA = {_BYTEAOID};
 static constexpr std::initializer_list<std::size_t> TEXT = {_CHAROID, _VARCHAROID, _TEXTOID};
 static constexpr std::initializer_list<std::size_t> UUID = {_UUIDOID};
+static constexpr std::initializer_list<std::size_t> NUMERIC = {_NUMERICOID};
+static constexpr std::initializer_list<std::size_t> JSON = {_JSONOID, _JSONBOID};
+static constexpr std::initializer_list<std::size_t> ARRAY = {_BOOLARRAYOID, _BYTEAARRAYOID, _CHARARRAYOID, _INT2ARRAYOID, _INT4ARRAYOID,
+                                                             _TEXTARRAYOID, _VARCHARARRAYOID, _INT8ARRAYOID, _FLOAT4ARRAYOID, _FLOAT8ARRAYOID,
+                                                             _TIMESTAMPARRAYOID, _DATEARRAYOID, _TIMEARRAYOID, _TIMESTAMPTZARRAYOID, _UUIDARRAYOID,
+                                                             _NUMERICARRAYOID};
 
 static constexpr std::initializer_list<std::initializer_list<std::size_t>> TYPES = {
-BOOL,INT2,INT4,INT8,FLOAT4,FLOAT8,DATE,TIME,TIMETZ,TIMESTAMP,BYTEA,TEXT,UUID
+BOOL,INT2,INT4,INT8,FLOAT4,FLOAT8,DATE,TIME,TIMETZ,TIMESTAMP,BYTEA,TEXT,UUID,NUMERIC,JSON,ARRAY
 };
 
+static bool isAscii(const char * data, qint32 size)
+{
+    qint32 i = 0;
+
+#ifdef __SSE2__
+    for(; i + 16 <= size; i += 16)
+        if(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i))) != 0) return false;
+#endif
+
+    for(; i + 8 <= size; i += 8)
+    {
+        quint64 word;
+        std::memcpy(&word, data + i, sizeof (word));
+        if(word & Q_UINT64_C(0x8080808080808080)) return false;
+    }
+
+    for(; i < size; i++) if(data[i] & 0x80) return false;
+
+    return true;
+}
+
+static QString utf8String(const char * data, qint32 size)
+{
+    if(isAscii(data, size)) return QString::fromLatin1(data, size);
+    return QString::fromUtf8(data, size);
+}
+
+static constexpr bool oneOf(std::initializer_list<std::size_t> list, quint32 oid)
+{
+    for(auto v : list) if(v == oid) return true;
+    return false;
+}
+
 static constexpr std::size_t TypeMax()
 {
     std::size_t max = 0;
@@ -168,965 +283,5303 @@ template<std::size_t N>struct GotoPointers
     constexpr std::size_t size() const { return N; }
 };
 
-//--------------------------------------------------------------------------------------------------------
-
-#define TcpPacketSize 0xFFFF
-#define MinimumPackageSize 0x05
-
-Connection::Connection(QObject * parent) : QObject(parent)
+enum Kind : quint8
 {
-    _bufferOut.reserve(TcpPacketSize);
-    connect(&_socket, &QTcpSocket::connected, this, &Connection::makeStarupMessage);
-    connect(&_socket, &QTcpSocket::readyRead, this, &Connection::analyzePacket);
-    connect(&_socket, &QTcpSocket::disconnected, this, &Connection::close);
-    connect(&_socket, &QAbstractSocket::errorOccurred, this, [this](QAbstractSocket::SocketError)
-    {
-        Message e;
-        e._message = _socket.errorString();
-        emit error(e);
-    });
-}
+    UnknownKind,
+    BoolKind,
+    Int2Kind,
+    Int4Kind,
+    Int8Kind,
+    Float4Kind,
+    Float8Kind,
+    DateKind,
+    TimeKind,
+    TimeTzKind,
+    TimestampKind,
+    ByteaKind,
+    TextKind,
+    UuidKind,
+    NumericKind,
+    JsonKind,
+    ArrayKind,
+    CodecKind,
+    KindCount
+};
 
-Connection::~Connection()
+static constexpr auto Kinds = VariantValues<quint8>(
 {
-    close();
-}
-
-bool Connection::isConnect()
+   {BOOL, BoolKind},
+   {INT2, Int2Kind},
+   {INT4, Int4Kind},
+   {INT8, Int8Kind},
+   {FLOAT4, Float4Kind},
+   {FLOAT8, Float8Kind},
+   {DATE, DateKind},
+   {TIME, TimeKind},
+   {TIMETZ, TimeTzKind},
+   {TIMESTAMP, TimestampKind},
+   {BYTEA, ByteaKind},
+   {TEXT, TextKind},
+   {UUID, UuidKind},
+   {NUMERIC, NumericKind},
+   {JSON, JsonKind},
+   {ARRAY, ArrayKind}
+});
+
+static inline quint8 kindOf(quint32 oid)
 {
-    return _auth_success;
+    return (Kinds.size() < oid) ? quint8(UnknownKind) : Kinds.values[oid];
 }
 
-void Connection::connection(const QHostAddress & address, quint16 port, const QString & user, const QString & password, const QString & database)
-{
-    close();
+//--------------------------------------------------------------------------------------------------------
 
-    _user = user.toUtf8();
-    _password = password.toUtf8();
-    _database = database.toUtf8();
+template<typename T> struct Binary;
 
-    _socket.connectToHost(address, port);
-}
+template<> struct Binary<bool>
+{
+    static bool accepts(quint32 oid) { return oneOf(BOOL, oid); }
+    static bool read(const char * data, qint32) { return data[0] != 0; }
+    static void write(QByteArray & out, bool v) { out.append(char(v ? 1 : 0)); }
+};
 
-void Connection::taskFromQueue()
+template<> struct Binary<qint16>
 {
-    _bufferOut.truncate(0);
-    Query * query = _tasks.head();
+    static bool accepts(quint32 oid) { return oneOf(INT2, oid); }
+    static qint16 read(const char * data, qint32) { return qFromBigEndian<qint16>(data); }
+    static void write(QByteArray & out, qint16 v) { v = qToBigEndian(v); out.append(reinterpret_cast<char *>(&v), sizeof(qint16)); }
+};
 
-    if(query->_prepare)
-    {
-       if(query->_prepareFinished) runBindQuery(query); else runPrepareQuery(query);
-    }
-    else runQuery(query);
-}
+template<> struct Binary<qint32>
+{
+    static bool accepts(quint32 oid) { return oneOf(INT4, oid); }
+    static qint32 read(const char * data, qint32) { return qFromBigEndian<qint32>(data); }
+    static void write(QByteArray & out, qint32 v) { v = qToBigEndian(v); out.append(reinterpret_cast<char *>(&v), sizeof(qint32)); }
+};
 
-void Connection::endTask()
+template<> struct Binary<qint64>
 {
-    if(_tasks.size() > 0)
-    {
-       Query * query = _tasks.dequeue();
+    static bool accepts(quint32 oid) { return oneOf(INT8, oid); }
+    static qint64 read(const char * data, qint32) { return qFromBigEndian<qint64>(data); }
+    static void write(QByteArray & out, qint64 v) { v = qToBigEndian(v); out.append(reinterpret_cast<char *>(&v), sizeof(qint64)); }
+};
 
-       if(query->_prepare && query->_bindValues.isEmpty())
-       {
-          query->_prepareFinished = true;
-          emit query->prepareFinished();
-       }
-       else emit query->executeFinished();
+template<> struct Binary<float>
+{
+    static bool accepts(quint32 oid) { return oneOf(FLOAT4, oid); }
+    static float read(const char * data, qint32) { return qFromBigEndian<float>(data); }
+    static void write(QByteArray & out, float v) { v = qToBigEndian(v); out.append(reinterpret_cast<char *>(&v), sizeof(float)); }
+};
 
-       if(_tasks.size() > 0) taskFromQueue();
-    }
-}
+template<> struct Binary<double>
+{
+    static bool accepts(quint32 oid) { return oneOf(FLOAT8, oid); }
+    static double read(const char * data, qint32) { return qFromBigEndian<double>(data); }
+    static void write(QByteArray & out, double v) { v = qToBigEndian(v); out.append(reinterpret_cast<char *>(&v), sizeof(double)); }
+};
 
-void Connection::addQuery(Query * query)
+static qint64 floorMSecs(qint64 microseconds)
 {
-    _tasks.enqueue(query);
-    if(_tasks.head() == query) taskFromQueue();
+    return (microseconds >= 0) ? microseconds / 1000 : -((-microseconds + 999) / 1000);
 }
 
-void Connection::runQuery(Query * query)
+template<> struct Binary<QDate>
 {
-    const char BDES_msgs[] = {0x42, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x44,
-                              0x00, 0x00, 0x00, 0x06, 0x50, 0x00, 0x45, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00,
-                              0x53, 0x00, 0x00, 0x00, 0x04};
+    static bool accepts(quint32 oid) { return oneOf(DATE, oid); }
+    static QDate read(const char * data, qint32) { return QDate::fromJulianDay(PostgresEpochDays + qFromBigEndian<qint32>(data)); }
+    static void write(QByteArray & out, const QDate & v) { Binary<qint32>::write(out, qint32(v.toJulianDay() - PostgresEpochDays)); }
+};
 
-    constexpr quint32 sz = sizeof(quint32) + 4;
-    QByteArray data = query->_lastQuery.toUtf8();
-    quint32 size = sz + data.size();
+template<> struct Binary<QTime>
+{
+    static bool accepts(quint32 oid) { return oneOf(TIME, oid); }
+    static QTime read(const char * data, qint32) { return QTime::fromMSecsSinceStartOfDay(int(qFromBigEndian<qint64>(data)/1000)); }
+    static void write(QByteArray & out, const QTime & v) { Binary<qint64>::write(out, qint64(v.msecsSinceStartOfDay())*1000); }
+};
 
-    size = qToBigEndian(size);
+#if QT_VERSION >= 0x060500
+#define UtcZone QTimeZone::UTC
+#define OffsetZone(seconds) QTimeZone::fromSecondsAheadOfUtc(seconds)
+#else
+#define UtcZone Qt::UTC
+#define OffsetZone(seconds) Qt::OffsetFromUTC, seconds
+#endif
 
-    _bufferOut.append(Parse);
-    _bufferOut.append(reinterpret_cast<char *>(&size), sizeof(quint32));
-    _bufferOut.append(char(0));
-    _bufferOut.append(data);
-    _bufferOut.append(3, 0);
+template<> struct Binary<QDateTime>
+{
+    static bool accepts(quint32 oid) { return oneOf(TIMESTAMP, oid); }
+    static QDateTime read(const char * data, qint32) { return QDateTime::fromMSecsSinceEpoch(PostgresEpochMSecs + floorMSecs(qFromBigEndian<qint64>(data)), UtcZone); }
+    static void write(QByteArray & out, const QDateTime & v) { Binary<qint64>::write(out, (v.toMSecsSinceEpoch() - PostgresEpochMSecs)*1000); }
+    static QDateTime readTz(const char * data, qint32)
+    {
+        return QDateTime(QDate::fromJulianDay(0),
+                         QTime::fromMSecsSinceStartOfDay(int(qFromBigEndian<qint64>(data)/1000)),
+                         OffsetZone(-qFromBigEndian<qint32>(data + sizeof (qint64))));
+    }
+};
 
-    _bufferOut.append(BDES_msgs, sizeof (BDES_msgs));
-    _socket.write(_bufferOut);
-}
+template<> struct Binary<QString>
+{
+    static bool accepts(quint32 oid) { return oneOf(TEXT, oid); }
+    static QString read(const char * data, qint32 size) { return utf8String(data, size); }
+    static void write(QByteArray & out, const QString & v) { out.append(v.toUtf8()); }
+};
 
-void Connection::runPrepareQuery(Query * query)
+template<> struct Binary<QByteArray>
 {
-    const unsigned char sync[] = {0x53, 0x00, 0x00, 0x00, 0x04};
+    static bool accepts(quint32 oid) { return oneOf(BYTEA, oid); }
+    static QByteArray read(const char * data, qint32 size) { return QByteArray(data, size); }
+    static void write(QByteArray & out, const QByteArray & v) { out.append(v); }
+};
 
-    constexpr quint32 sz = sizeof(quint32) + 4;
-    QByteArray data = query->_lastQuery.toUtf8();
-    quint32 size = sz + query->_stmtName.size() + data.size();
+template<> struct Binary<QUuid>
+{
+    static bool accepts(quint32 oid) { return oneOf(UUID, oid); }
+    static QUuid read(const char * data, qint32) { return QUuid::fromRfc4122(QByteArray::fromRawData(data, 16)); }
+    static void write(QByteArray & out, const QUuid & v) { out.append(v.toRfc4122()); }
+};
 
-    size = qToBigEndian(size);
+#define NumericHeaderSize 8
+#define NumericPositive 0x0000
+#define NumericNegative 0x4000
+#define NumericNaN 0xC000
+#define NumericPositiveInfinity 0xD000
+#define NumericNegativeInfinity 0xF000
+#define NumericMaxScale 0x3FFF
+#define NumericBase 10000
 
-    _bufferOut.append(Parse);
-    _bufferOut.append(reinterpret_cast<char *>(&size), sizeof(quint32));
-    _bufferOut.append(query->_stmtName);
-    _bufferOut.append(char(0));
-    _bufferOut.append(data);
-    _bufferOut.append(3, 0);
+struct NumericHeader
+{
+    qint16 digits = 0, weight = 0;
+    quint16 sign = NumericPositive, scale = 0;
+    const char * data = nullptr;
 
-    size = sizeof(quint32) + query->_stmtName.size() + 2;
-    size = qToBigEndian(size);
+    NumericHeader(const char * value, qint32 size)
+    {
+        if(size < NumericHeaderSize) return;
 
-    _bufferOut.append(char(Describe));
-    _bufferOut.append(reinterpret_cast<char *>(&size), sizeof(quint32));
-    _bufferOut.append(char(Statement));
-    _bufferOut.append(query->_stmtName);
-    _bufferOut.append(char(0));
+        digits = qFromBigEndian<qint16>(value);
+        weight = qFromBigEndian<qint16>(value + sizeof(qint16));
+        sign = qFromBigEndian<quint16>(value + 2 * sizeof(qint16));
+        scale = qFromBigEndian<quint16>(value + 3 * sizeof(qint16));
 
-    _bufferOut.append(reinterpret_cast<const char *>(&sync), sizeof(sync));
-    _socket.write(_bufferOut);
-}
+        if(digits >= 0 && size >= NumericHeaderSize + digits * qint32(sizeof(qint16))) data = value + NumericHeaderSize;
+    }
 
-void Connection::runBindQuery(Query * query)
-{
-    const char ES_msgs[] = {0x45, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x53, 0x00, 0x00, 0x00, 0x04};
-    const char bin_format[] = {0x00, 0x01, 0x00, 0x01};
-    const char * const msg = "The binding does not support the type OID: ";
+    bool isValid() const { return data != nullptr; }
+    bool isSpecial() const { return sign != NumericPositive && sign != NumericNegative; }
+    int digit(int i) const { return (i >= 0 && i < digits) ? qFromBigEndian<qint16>(data + i * sizeof(qint16)) : 0; }
+};
 
-    constexpr auto types = GotoPointers<TypeMax()>(
+static double numericToDouble(const char * data, qint32 size)
+{
+    const NumericHeader n(data, size);
 
-      &&_default,
+    if(!n.isValid() || n.sign == NumericNaN) return std::numeric_limits<double>::quiet_NaN();
+    if(n.sign == NumericPositiveInfinity) return std::numeric_limits<double>::infinity();
+    if(n.sign == NumericNegativeInfinity) return -std::numeric_limits<double>::infinity();
+    if(n.digits == 0) return 0;
 
-      {
-        {BOOL, &&_BOOL},
-        {INT2, &&_INT2},
-        {INT4, &&_INT4},
-        {INT8, &&_INT8},
-        {FLOAT4, &&_FLOAT4},
-        {FLOAT8, &&_FLOAT8},
-        {DATE, &&_DATE},
-        {TIME, &&_TIME},
-        {TIMETZ, &&_TIMETZ},
-        {TIMESTAMP, &&_TIMESTAMP},
-        {BYTEA, &&_BYTEA},
-        {TEXT, &&_TEXT},
-        {UUID, &&_UUID}
-      }
+    constexpr double powers[] = {1e0, 1e4, 1e8, 1e12, 1e16, 1e20};
 
-    );
+    quint64 integer = 0;
+    int i = 0;
 
-    constexpr auto sizes = VariantValues<quint32>(
+    for(; i < n.digits && i < 4; i++) integer = integer * NumericBase + n.digit(i);
 
-      {
-        {BOOL, sizeof(bool)},
-        {INT2, sizeof(qint16)},
-        {INT4, sizeof(qint32)},
-        {INT8, sizeof(qint64)},
-        {FLOAT4, sizeof(float)},
-        {FLOAT8, sizeof(double)},
-        {DATE, sizeof(qint32)},
-        {TIME, sizeof(qint64)},
-        {TIMETZ, 12},
-        {TIMESTAMP, sizeof(qint64)},
-        {BYTEA, 0},
-        {TEXT, 0},
-        {UUID, 16}
-      },
-
-      [](quint32 size){ return qToBigEndian(size); }
+    double value = double(integer);
+    for(; i < n.digits; i++) value = value * NumericBase + n.digit(i);
 
-    );
+    int exponent = n.weight - (n.digits - 1);
+    int e = std::abs(exponent);
+    double scale = (e < 6) ? powers[e] : std::pow(10.0, 4 * e);
 
-    constexpr quint32 sz = sizeof(quint32) + 10;
-    quint32 size = sz + query->_stmtName.size();
+    value = (exponent < 0) ? value / scale : value * scale;
+    return (n.sign == NumericNegative) ? -value : value;
+}
 
-    _bufferOut.append(Bind);
+static qint64 numericToLongLong(const char * data, qint32 size, bool * ok)
+{
+    const NumericHeader n(data, size);
 
-    {
-       quint32 sz = qToBigEndian(size);
-       _bufferOut.append(reinterpret_cast<char *>(&sz), sizeof(quint32));
-    }
+    if(ok != nullptr) *ok = false;
+    if(!n.isValid() || n.isSpecial()) return 0;
 
-    _bufferOut.append(char(0));
-    _bufferOut.append(query->_stmtName);
-    _bufferOut.append(char(0));
+    for(int i = qMax(0, n.weight + 1); i < n.digits; i++) if(n.digit(i) != 0) return 0;
 
-    quint16 values = query->_bindValues.size();
+    quint64 value = 0;
 
-    if(values != query->_preparedParametrs.size())
+    for(int i = 0; i <= n.weight; i++)
     {
-       Message e;
-       e._message += tr("Incorrect value binding size: ") + QString::number(values) + " != " + QString::number(query->_preparedParametrs.size());
-       emit query->error(e);
-       return;
+        quint64 digit = n.digit(i);
+        if(value > (std::numeric_limits<quint64>::max() - digit) / NumericBase) return 0;
+        value = value * NumericBase + digit;
     }
 
-    if(values > 0)
+    if(n.sign == NumericNegative)
     {
-       size += values * 2 + values * 4;
-       values = qToBigEndian(values);
-       _bufferOut.append(reinterpret_cast<char *>(&values), sizeof(quint16));
-
-       quint16 type = qToBigEndian(quint16(1));
-       for(int i = 0; i < query->_bindValues.size(); i++) _bufferOut.append(reinterpret_cast<char *>(&type), sizeof(quint16));
-       _bufferOut.append(reinterpret_cast<char *>(&values), sizeof(quint16));
-
-       for(int i = 0; i < query->_bindValues.size(); i++)
-       {   
-           quint32 oid = query->_preparedParametrs[i];
+       if(value > quint64(std::numeric_limits<qint64>::max()) + 1) return 0;
+       if(ok != nullptr) *ok = true;
+       return qint64(0 - value);
+    }
 
-           if(types.size() < oid)
-           {
-              Message e;
-              e._message += tr(msg) + QString::number(oid);
-              emit query->error(e);
-              return;
-           }
+    if(value > quint64(std::numeric_limits<qint64>::max())) return 0;
+    if(ok != nullptr) *ok = true;
+    return qint64(value);
+}
 
-           const QVariant & value = query->_bindValues[i];
+static bool appendNumeric(QByteArray & out, const char * data, qint32 size)
+{
+    const NumericHeader n(data, size);
 
-           if(oid <= types.size()) goto *types.pointers[oid];
-           else goto _default;
+    if(!n.isValid()) return false;
 
-           _BOOL:
-           {
-             size += sizeof(bool);
+    if(n.isSpecial())
+    {
+       out.append((n.sign == NumericNaN) ? "NaN" : (n.sign == NumericPositiveInfinity) ? "Infinity" : "-Infinity");
+       return true;
+    }
 
-             bool v = value.toBool();
-             _bufferOut.append(reinterpret_cast<const char *>(&sizes.values[oid]), sizeof(quint32));
-             _bufferOut.append(reinterpret_cast<char *>(&v), sizeof(bool));
-           }
-           continue;
+    out.reserve(out.size() + (qMax<int>(n.weight, 0) + 1) * 4 + n.scale + 2);
 
-           _INT2:
-           {
-             size += sizeof(qint16);
+    if(n.sign == NumericNegative) out.append('-');
 
-             qint16 v = qToBigEndian(qint16(value.toInt()));
-             _bufferOut.append(reinterpret_cast<const char *>(&sizes.values[oid]), sizeof(quint32));
-             _bufferOut.append(reinterpret_cast<char *>(&v), sizeof(qint16));
-           }
-           continue;
+    if(n.weight < 0) out.append('0');
+    else
+    {
+       for(int i = 0; i <= n.weight; i++)
+       {
+           int d = n.digit(i);
+           const char group[] = {char('0' + d / 1000), char('0' + d / 100 % 10), char('0' + d / 10 % 10), char('0' + d % 10)};
 
-           _INT4:
+           if(i > 0) out.append(group, 4);
+           else
            {
-             size += sizeof(qint32);
-
-             qint32 v = qToBigEndian(value.toInt());
-             _bufferOut.append(reinterpret_cast<const char *>(&sizes.values[oid]), sizeof(quint32));
-             _bufferOut.append(reinterpret_cast<char *>(&v), sizeof(qint32));
+              int skip = (d >= 1000) ? 0 : (d >= 100) ? 1 : (d >= 10) ? 2 : 3;
+              out.append(group + skip, 4 - skip);
            }
-           continue;
+       }
+    }
 
-           _INT8:
-           {
-             size += sizeof(qint64);
+    if(n.scale > 0)
+    {
+       out.append('.');
 
-             qint64 v = qToBigEndian(value.toLongLong());
-             _bufferOut.append(reinterpret_cast<const char *>(&sizes.values[oid]), sizeof(quint32));
-             _bufferOut.append(reinterpret_cast<char *>(&v), sizeof(qint64));
-           }
-           continue;
+       for(int i = n.weight + 1, written = 0; written < n.scale; i++)
+       {
+           int d = n.digit(i);
+           const char group[] = {char('0' + d / 1000), char('0' + d / 100 % 10), char('0' + d / 10 % 10), char('0' + d % 10)};
 
-           _FLOAT4:
-           {
-             size += sizeof(float);
+           int count = qMin(4, n.scale - written);
+           out.append(group, count);
+           written += count;
+       }
+    }
 
-             float v = qToBigEndian(value.toFloat());
-             _bufferOut.append(reinterpret_cast<const char *>(&sizes.values[oid]), sizeof(quint32));
-             _bufferOut.append(reinterpret_cast<char *>(&v), sizeof(float));
-           }
-           continue;
+    return true;
+}
 
-           _FLOAT8:
-           {
-             size += sizeof(double);
+static QString numericToString(const char * data, qint32 size)
+{
+    QByteArray out;
+    if(!appendNumeric(out, data, size)) return QString();
+    return QString::fromLatin1(out);
+}
 
-             double v = qToBigEndian(value.toDouble());
-             _bufferOut.append(reinterpret_cast<const char *>(&sizes.values[oid]), sizeof(quint32));
-             _bufferOut.append(reinterpret_cast<char *>(&v), sizeof(double));
-           }
-           continue;
+static QByteArray numericBinary(quint16 sign, qint16 weight, quint16 scale, const QVector<qint16> & digits = QVector<qint16>())
+{
+    QByteArray out;
+    out.reserve(NumericHeaderSize + digits.size() * sizeof(qint16));
 
-           _DATE:
-           {
-             size += sizeof(qint32);
+    Binary<qint16>::write(out, qint16(digits.size()));
+    Binary<qint16>::write(out, weight);
+    Binary<qint16>::write(out, qint16(sign));
+    Binary<qint16>::write(out, qint16(scale));
 
-             qint32 v = qToBigEndian(qint32(QDate(2000, 1, 1).daysTo(value.toDate())));
-             _bufferOut.append(reinterpret_cast<const char *>(&sizes.values[oid]), sizeof(quint32));
-             _bufferOut.append(reinterpret_cast<char *>(&v), sizeof(qint32));
-           }
-           continue;
+    for(qint16 d : digits) Binary<qint16>::write(out, d);
+    return out;
+}
 
-           _TIME:
-           {
-             size += sizeof(qint64);
+template<> struct Binary<Numeric>
+{
+    static bool accepts(quint32 oid) { return oneOf(NUMERIC, oid); }
+    static Numeric read(const char * data, qint32 size) { Numeric v; v._data = QByteArray(data, size); return v; }
+    static void write(QByteArray & out, const Numeric & v) { out.append(v._data); }
+};
 
-             qint64 v = qToBigEndian(qint64(value.toTime().msecsSinceStartOfDay())*1000);
-             _bufferOut.append(reinterpret_cast<const char *>(&sizes.values[oid]), sizeof(quint32));
-             _bufferOut.append(reinterpret_cast<char *>(&v), sizeof(qint64));
-           }
-           continue;
+#define JsonbVersion 0x01
 
-           _TIMETZ:
-           {
-             size += 12;
-
-             QDateTime dt = value.toDateTime();
-             qint64 t =qToBigEndian(qint64(dt.time().msecsSinceStartOfDay())*1000);
-             qint32 tz = qFromBigEndian<qint32>(-dt.timeZone().offsetFromUtc(dt));
-             _bufferOut.append(reinterpret_cast<const char *>(&sizes.values[oid]), sizeof(quint32));
-             _bufferOut.append(reinterpret_cast<char *>(&t), sizeof(qint64));
-             _bufferOut.append(reinterpret_cast<char *>(&tz), sizeof(qint32));
-           }
-           continue;
+static QByteArray jsonText(const char * data, qint32 size)
+{
+    if(size > 0 && data[0] == JsonbVersion) return QByteArray::fromRawData(data + 1, size - 1);
+    return QByteArray::fromRawData(data, size);
+}
 
-           _TIMESTAMP:
-           {
-             size += sizeof(qint64);
+static QByteArray jsonBinary(const QVariant & value)
+{
+    const int type = value.userType();
 
-             qint64 v = qToBigEndian((value.toDateTime().toMSecsSinceEpoch() - 946674000000)*1000);
-             _bufferOut.append(reinterpret_cast<const char *>(&sizes.values[oid]), sizeof(quint32));
-             _bufferOut.append(reinterpret_cast<char *>(&v), sizeof(qint64));
-           }
-           continue;
+    if(type == QMetaType::QJsonDocument) return value.toJsonDocument().toJson(QJsonDocument::Compact);
+    if(type == QMetaType::QJsonObject) return QJsonDocument(value.toJsonObject()).toJson(QJsonDocument::Compact);
+    if(type == QMetaType::QJsonArray) return QJsonDocument(value.toJsonArray()).toJson(QJsonDocument::Compact);
+    if(type == QMetaType::QByteArray) return value.toByteArray();
+    if(type == QMetaType::QString) return value.toString().toUtf8();
 
-           _BYTEA:
-           {
-             QByteArray data = value.toByteArray();
-             quint32 sz = data.size();
-             size += sz;
-             sz = qToBigEndian(sz);
+    return QJsonDocument::fromVariant(value).toJson(QJsonDocument::Compact);
+}
 
-             _bufferOut.append(reinterpret_cast<char *>(&sz), sizeof(quint32));
-             _bufferOut.append(data.data(), data.size());
-           }
-           continue;
+template<> struct Binary<QJsonDocument>
+{
+    static bool accepts(quint32 oid) { return oneOf(JSON, oid); }
+    static QJsonDocument read(const char * data, qint32 size) { return QJsonDocument::fromJson(jsonText(data, size)); }
+    static void write(QByteArray & out, const QJsonDocument & v) { out.append(v.toJson(QJsonDocument::Compact)); }
+};
 
-           _TEXT:
-           {
-             QByteArray data = value.toByteArray();
-             quint32 sz = data.size();
-             size += sz;
-             sz = qToBigEndian(sz);
+//--------------------------------------------------------------------------------------------------------
 
-             _bufferOut.append(reinterpret_cast<char *>(&sz), sizeof(quint32));
-             _bufferOut.append(data.data(), data.size());
-           }
-           continue;
+template<typename T> struct Column
+{
+    using Reader = T (*)(const char *, qint32);
+    static Reader reader(quint32 oid) { return Binary<T>::accepts(oid) ? &Binary<T>::read : nullptr; }
+};
 
-           _UUID:
-           {
-             size += 16;
+template<> struct Column<qint64>
+{
+    using Reader = qint64 (*)(const char *, qint32);
 
-             _bufferOut.append(reinterpret_cast<const char *>(&sizes.values[oid]), sizeof(quint32));
-             _bufferOut.append(value.toUuid().toRfc4122().data(), 16);
-           }
-           continue;
+    static Reader microseconds(quint32 oid)
+    {
+        if(oneOf(TIMESTAMP, oid)) return [](const char * data, qint32) { return PostgresEpochUSecs + qFromBigEndian<qint64>(data); };
+        if(oneOf(TIME, oid) || oneOf(TIMETZ, oid)) return &Binary<qint64>::read;
+        return nullptr;
+    }
 
-           _default:
+    static Reader reader(quint32 oid)
+    {
+        if(oneOf(INT8, oid)) return &Binary<qint64>::read;
+        if(auto temporal = microseconds(oid)) return temporal;
+        if(oneOf(INT4, oid)) return [](const char * data, qint32 size) { return qint64(Binary<qint32>::read(data, size)); };
+        if(oneOf(INT2, oid)) return [](const char * data, qint32 size) { return qint64(Binary<qint16>::read(data, size)); };
+        return nullptr;
+    }
+};
 
-           Message e;
-           e._message += tr(msg) + QString::number(oid);
-           emit query->error(e);
-           return;
-       }
+template<> struct Column<double>
+{
+    using Reader = double (*)(const char *, qint32);
 
-       size = qToBigEndian(size);
-       _bufferOut.replace(1, sizeof(quint32), reinterpret_cast<char *>(&size), sizeof(quint32));
-    }
-    else
+    static Reader reader(quint32 oid)
     {
-       _bufferOut.append(4, 0);
+        if(oneOf(FLOAT8, oid)) return &Binary<double>::read;
+        if(oneOf(FLOAT4, oid)) return [](const char * data, qint32 size) { return double(Binary<float>::read(data, size)); };
+        if(oneOf(INT8, oid)) return [](const char * data, qint32 size) { return double(Binary<qint64>::read(data, size)); };
+        if(oneOf(INT4, oid)) return [](const char * data, qint32 size) { return double(Binary<qint32>::read(data, size)); };
+        if(oneOf(INT2, oid)) return [](const char * data, qint32 size) { return double(Binary<qint16>::read(data, size)); };
+        if(oneOf(NUMERIC, oid)) return &numericToDouble;
+        return nullptr;
     }
+};
 
-    _bufferOut.append(bin_format, sizeof(bin_format));
-    _bufferOut.append(ES_msgs, sizeof (ES_msgs));
-    _socket.write(_bufferOut);
-}
+template<typename T> struct Parameter
+{
+    using Writer = void (*)(QByteArray &, const T &);
+    static Writer writer(quint32 oid)
+    {
+        if(Binary<T>::accepts(oid)) return [](QByteArray & out, const T & v) { Binary<T>::write(out, v); };
+        return nullptr;
+    }
+};
 
-void Connection::close()
+template<typename T> struct IntegerParameter
 {
-    const unsigned char Termination[] = {0x58, 0x00, 0x00, 0x00, 0x04};
+    using Writer = void (*)(QByteArray &, const T &);
 
-    _pid = 0;
-    _key = 0;
+    static Writer writer(quint32 oid)
+    {
+        if(oneOf(INT2, oid)) return [](QByteArray & out, const T & v) { Binary<qint16>::write(out, qint16(v)); };
+        if(oneOf(INT4, oid)) return [](QByteArray & out, const T & v) { Binary<qint32>::write(out, qint32(v)); };
+        if(oneOf(INT8, oid)) return [](QByteArray & out, const T & v) { Binary<qint64>::write(out, qint64(v)); };
+        if(oneOf(NUMERIC, oid)) return [](QByteArray & out, const T & v) { Binary<Numeric>::write(out, Numeric::fromLongLong(v)); };
+        return nullptr;
+    }
+};
 
-    if(_socket.state() == QAbstractSocket::ConnectedState)
+template<typename T> struct FloatParameter
+{
+    using Writer = void (*)(QByteArray &, const T &);
+
+    static Writer writer(quint32 oid)
     {
-       if(_auth_success)
-       {
-          emit disconnected();
-          _socket.write(reinterpret_cast<const char *>(Termination), sizeof (Termination));
-          _socket.waitForBytesWritten();
-       }
-       _socket.close();
+        if(oneOf(FLOAT4, oid)) return [](QByteArray & out, const T & v) { Binary<float>::write(out, float(v)); };
+        if(oneOf(FLOAT8, oid)) return [](QByteArray & out, const T & v) { Binary<double>::write(out, double(v)); };
+        if(oneOf(NUMERIC, oid)) return [](QByteArray & out, const T & v) { Binary<Numeric>::write(out, Numeric::fromDouble(v)); };
+        return nullptr;
     }
-}
+};
 
-void Connection::errorOrNoticeResponse(const char * data, quint32 size, ErrorOrNotice type)
+template<> struct Parameter<qint16> : IntegerParameter<qint16>{};
+template<> struct Parameter<qint32> : IntegerParameter<qint32>{};
+template<> struct Parameter<qint64>
 {
-    quint32 pos = 0;
-    QLatin1String v, c, m;
+    using Writer = void (*)(QByteArray &, const qint64 &);
 
-    do
+    static Writer writer(quint32 oid)
     {
-       char type = *(data + pos);
+        if(oneOf(TIMESTAMP, oid)) return [](QByteArray & out, const qint64 & v) { Binary<qint64>::write(out, v - PostgresEpochUSecs); };
+        if(oneOf(TIME, oid)) return [](QByteArray & out, const qint64 & v) { Binary<qint64>::write(out, v); };
+        return IntegerParameter<qint64>::writer(oid);
+    }
+};
+template<> struct Parameter<float> : FloatParameter<float>{};
+template<> struct Parameter<double> : FloatParameter<double>{};
 
-       pos++;
-       QLatin1String temp(data + pos);
-       pos += temp.size();
-       pos++;
+template<> struct Parameter<QString>
+{
+    using Writer = void (*)(QByteArray &, const QString &);
 
-       switch (type)
-       {
-               case ErrorOrNoticeType: v = temp;
-               break;
-               case ErrorOrNoticeCode: c = temp;
-               break;
-               case ErrorOrNoticeMessage: m = temp;
-               break;
-       }
+    static Writer writer(quint32 oid)
+    {
+        if(oneOf(TEXT, oid) || oid == _JSONOID) return &Binary<QString>::write;
+        if(oid == _JSONBOID) return [](QByteArray & out, const QString & v) { out.append(char(JsonbVersion)); Binary<QString>::write(out, v); };
+        return nullptr;
     }
-    while(pos < size || (v.size() == 0 || c.size() == 0 || m.size() == 0));
+};
 
-    if(type == ErrorOrNotice::Error)
+template<> struct Parameter<QByteArray>
+{
+    using Writer = void (*)(QByteArray &, const QByteArray &);
+
+    static Writer writer(quint32 oid)
     {
-       Message e;
-       e._importance = v;
-       e._code = c;
-       e._message = m;
+        if(oneOf(BYTEA, oid) || oneOf(TEXT, oid) || oid == _JSONOID) return &Binary<QByteArray>::write;
+        if(oid == _JSONBOID) return [](QByteArray & out, const QByteArray & v) { out.append(char(JsonbVersion)); out.append(v); };
+        return nullptr;
+    }
+};
 
-       if(_tasks.size() > 0) emit _tasks.head()->error(e);
-       else emit error(e);
+template<> struct Parameter<QJsonDocument>
+{
+    using Writer = void (*)(QByteArray &, const QJsonDocument &);
+
+    static Writer writer(quint32 oid)
+    {
+        if(oid == _JSONOID) return &Binary<QJsonDocument>::write;
+        if(oid == _JSONBOID) return [](QByteArray & out, const QJsonDocument & v) { out.append(char(JsonbVersion)); Binary<QJsonDocument>::write(out, v); };
+        return nullptr;
     }
-    else
+};
+
+//--------------------------------------------------------------------------------------------------------
+
+#define ArrayMaxDimensions 6
+#define ArrayHeaderSize 12
+
+static constexpr std::initializer_list<std::pair<quint32, quint32>> ArrayElements = {
+   {_BOOLARRAYOID, _BOOLOID},
+   {_BYTEAARRAYOID, _BYTEAOID},
+   {_CHARARRAYOID, _CHAROID},
+   {_INT2ARRAYOID, _INT2OID},
+   {_INT4ARRAYOID, _INT4OID},
+   {_TEXTARRAYOID, _TEXTOID},
+   {_VARCHARARRAYOID, _VARCHAROID},
+   {_INT8ARRAYOID, _INT8OID},
+   {_FLOAT4ARRAYOID, _FLOAT4OID},
+   {_FLOAT8ARRAYOID, _FLOAT8OID},
+   {_TIMESTAMPARRAYOID, _TIMESTAMPOID},
+   {_DATEARRAYOID, _DATEOID},
+   {_TIMEARRAYOID, _TIMEOID},
+   {_TIMESTAMPTZARRAYOID, _TIMESTAMPTZOID},
+   {_UUIDARRAYOID, _UUIDOID},
+   {_NUMERICARRAYOID, _NUMERICOID}
+};
+
+static quint32 arrayElement(quint32 oid)
+{
+    for(const auto & v : ArrayElements) if(v.first == oid) return v.second;
+    return 0;
+}
+
+static qint64 arrayCount(const char * data, qint32 dimensions, qint64 limit)
+{
+    qint64 count = (dimensions > 0) ? 1 : 0;
+
+    for(qint32 i = 0; i < dimensions; i++)
     {
-       Message n;
-       n._importance = v;
-       n._code = c;
-       n._message = m;
+        const qint32 length = qFromBigEndian<qint32>(data + ArrayHeaderSize + i * 2 * sizeof(qint32));
+        if(length < 0) return -1;
 
-       if(_tasks.size() > 0) emit _tasks.head()->notice(n);
-       else emit notice(n);
+        count *= length;
+        if(count > limit) return -1;
     }
+
+    return count;
 }
 
-bool Connection::authentication(const char * data)
+template<typename C> static C readArray(const char * data, qint32 size)
 {
-    quint32 type = qFromBigEndian<quint32>(data);
+    using T = typename C::value_type;
+    C values;
 
-    if(type == MD5password)
+    if(size < ArrayHeaderSize) return values;
+
+    qint32 dimensions = qFromBigEndian<qint32>(data);
+    quint32 oid = qFromBigEndian<quint32>(data + 2 * sizeof(qint32));
+
+    if(dimensions <= 0 || dimensions > ArrayMaxDimensions || !Binary<T>::accepts(oid)) return values;
+    if(size < ArrayHeaderSize + dimensions * 2 * qint32(sizeof(qint32))) return values;
+
+    const char * pos = data + ArrayHeaderSize + dimensions * 2 * sizeof(qint32), * end = data + size;
+    const qint64 count = arrayCount(data, dimensions, (end - pos) / qint64(sizeof(qint32)));
+    if(count < 0) return values;
+
+    values.reserve(count);
+
+    for(qint64 i = 0; i < count; i++)
     {
-       QByteArray hash = "md5" + QCryptographicHash::hash(
-                                  QCryptographicHash::hash(_password+_user,
-                                   QCryptographicHash::Md5).toHex() + QByteArray(data + 4, 4),
-                                    QCryptographicHash::Md5).toHex();
+        if(end - pos < qint64(sizeof(qint32))) return C();
 
-       _bufferOut.append(PasswordMessage);
+        qint32 length = qFromBigEndian<qint32>(pos);
+        pos += sizeof(qint32);
 
-       quint32 size = sizeof(quint32) + hash.size();
-       size++;
+        if(length < 0)
+        {
+           values.push_back(T());
+           continue;
+        }
 
-       size = qToBigEndian(size);
+        if(length > end - pos) return C();
 
-       _bufferOut.append(reinterpret_cast<char *>(&size), sizeof (size));
-       _bufferOut.append(hash);
-       _bufferOut.append(char(0));
+        values.push_back(Binary<T>::read(pos, length));
+        pos += length;
+    }
 
-       _socket.write(_bufferOut);
-       _bufferOut.truncate(0);
+    return values;
+}
 
-       return true;
+template<typename T> static void writeArray(QByteArray & out, quint32 oid, const T * values, qsizetype count)
+{
+    const qint32 header[] = {qToBigEndian(qint32(count > 0 ? 1 : 0)), 0, qToBigEndian(qint32(oid)), qToBigEndian(qint32(count)), qToBigEndian(qint32(1))};
+    out.append(reinterpret_cast<const char *>(header), (count > 0) ? sizeof(header) : ArrayHeaderSize);
+
+    if(std::is_arithmetic<T>::value) out.reserve(out.size() + count * (sizeof(qint32) + sizeof(T)));
+
+    for(qsizetype i = 0; i < count; i++)
+    {
+        qsizetype at = out.size();
+        out.append(sizeof(quint32), 0);
+
+        Binary<T>::write(out, values[i]);
+
+        quint32 size = qToBigEndian(quint32(out.size() - at - sizeof(quint32)));
+        std::memcpy(out.data() + at, &size, sizeof(quint32));
     }
-    else if(type == AuthenticationSucces)
+}
+
+template<typename T> static bool writeArray(QByteArray & out, quint32 oid, const QVariant & value)
+{
+    QVector<T> values;
+
+    if(value.userType() == qMetaTypeId<QVector<T>>()) values = value.value<QVector<T>>();
+    else if(value.canConvert<QVariantList>())
     {
-       _auth_success = true;
-       emit connected();
-       return true;
+       const QSequentialIterable iterable = value.value<QSequentialIterable>();
+       for(const QVariant & v : iterable) values.append(v.value<T>());
     }
+    else return false;
 
-    return false;
+    if constexpr(std::is_same<T, Numeric>::value)
+    {
+       for(const Numeric & v : std::as_const(values)) if(v.isNull()) return false;
+    }
+
+    writeArray(out, oid, values.constData(), values.size());
+    return true;
 }
 
-void Connection::parameterStatus(const char * data)
+static bool writeArray(QByteArray & out, quint32 oid, const QVariant & value)
 {
-    QLatin1String key(data);
-    data++;
-    _parametersStatus[key] = QLatin1String(data + key.size());
+    constexpr auto types = GotoPointers<KindCount>(
+
+      &&_default,
+
+      {
+        {BoolKind, &&_BOOL},
+        {Int2Kind, &&_INT2},
+        {Int4Kind, &&_INT4},
+        {Int8Kind, &&_INT8},
+        {Float4Kind, &&_FLOAT4},
+        {Float8Kind, &&_FLOAT8},
+        {DateKind, &&_DATE},
+        {TimeKind, &&_TIME},
+        {TimestampKind, &&_TIMESTAMP},
+        {ByteaKind, &&_BYTEA},
+        {TextKind, &&_TEXT},
+        {UuidKind, &&_UUID},
+        {NumericKind, &&_NUMERIC}
+      }
+
+    );
+
+    goto *types.pointers[kindOf(oid)];
+
+    _BOOL: return writeArray<bool>(out, oid, value);
+    _INT2: return writeArray<qint16>(out, oid, value);
+    _INT4: return writeArray<qint32>(out, oid, value);
+    _INT8: return writeArray<qint64>(out, oid, value);
+    _FLOAT4: return writeArray<float>(out, oid, value);
+    _FLOAT8: return writeArray<double>(out, oid, value);
+    _DATE: return writeArray<QDate>(out, oid, value);
+    _TIME: return writeArray<QTime>(out, oid, value);
+    _TIMESTAMP: return writeArray<QDateTime>(out, oid, value);
+    _BYTEA: return writeArray<QByteArray>(out, oid, value);
+    _TEXT: return writeArray<QString>(out, oid, value);
+    _UUID: return writeArray<QUuid>(out, oid, value);
+    _NUMERIC: return writeArray<Numeric>(out, oid, value);
+    _default: return false;
 }
 
-void Connection::backendKeyData(const char * data)
+static QVariant readArray(const char * data, qint32 size)
 {
-    _pid = qFromBigEndian<quint32>(data);
-    _key = qFromBigEndian<quint32>(data + sizeof (quint32));
+    constexpr auto types = GotoPointers<KindCount>(
+
+      &&_default,
+
+      {
+        {BoolKind, &&_BOOL},
+        {Int2Kind, &&_INT2},
+        {Int4Kind, &&_INT4},
+        {Int8Kind, &&_INT8},
+        {Float4Kind, &&_FLOAT4},
+        {Float8Kind, &&_FLOAT8},
+        {DateKind, &&_DATE},
+        {TimeKind, &&_TIME},
+        {TimestampKind, &&_TIMESTAMP},
+        {ByteaKind, &&_BYTEA},
+        {TextKind, &&_TEXT},
+        {UuidKind, &&_UUID},
+        {NumericKind, &&_NUMERIC}
+      }
+
+    );
+
+    quint32 oid = (size < ArrayHeaderSize) ? 0 : qFromBigEndian<quint32>(data + 2 * sizeof(qint32));
+    goto *types.pointers[kindOf(oid)];
+
+    _BOOL: return QVariant::fromValue(readArray<QVector<bool>>(data, size));
+    _INT2: return QVariant::fromValue(readArray<QVector<qint16>>(data, size));
+    _INT4: return QVariant::fromValue(readArray<QVector<qint32>>(data, size));
+    _INT8: return QVariant::fromValue(readArray<QVector<qint64>>(data, size));
+    _FLOAT4: return QVariant::fromValue(readArray<QVector<float>>(data, size));
+    _FLOAT8: return QVariant::fromValue(readArray<QVector<double>>(data, size));
+    _DATE: return QVariant::fromValue(readArray<QVector<QDate>>(data, size));
+    _TIME: return QVariant::fromValue(readArray<QVector<QTime>>(data, size));
+    _TIMESTAMP: return QVariant::fromValue(readArray<QVector<QDateTime>>(data, size));
+    _BYTEA: return QVariant::fromValue(readArray<QVector<QByteArray>>(data, size));
+    _TEXT: return readArray<QStringList>(data, size);
+    _UUID: return QVariant::fromValue(readArray<QVector<QUuid>>(data, size));
+    _NUMERIC: return QVariant::fromValue(readArray<QVector<Numeric>>(data, size));
+    _default: return QByteArray(data, size);
 }
 
-void Connection::readyForQuery(const char * data)
+static QMetaType::Type arrayType(quint32 oid)
 {
-    switch(char(*data))
+    static const auto types = VariantValues<int, KindCount>(
     {
-        case Idle: endTask();
-        break;
-        case Transaction: endTask();
-        break;
-        case Exit:
-        break;
+       {{BoolKind}, qMetaTypeId<QVector<bool>>()},
+       {{Int2Kind}, qMetaTypeId<QVector<qint16>>()},
+       {{Int4Kind}, qMetaTypeId<QVector<qint32>>()},
+       {{Int8Kind}, qMetaTypeId<QVector<qint64>>()},
+       {{Float4Kind}, qMetaTypeId<QVector<float>>()},
+       {{Float8Kind}, qMetaTypeId<QVector<double>>()},
+       {{DateKind}, qMetaTypeId<QVector<QDate>>()},
+       {{TimeKind}, qMetaTypeId<QVector<QTime>>()},
+       {{TimestampKind}, qMetaTypeId<QVector<QDateTime>>()},
+       {{ByteaKind}, qMetaTypeId<QVector<QByteArray>>()},
+       {{TextKind}, QMetaType::QStringList},
+       {{UuidKind}, qMetaTypeId<QVector<QUuid>>()},
+       {{NumericKind}, qMetaTypeId<QVector<Numeric>>()}
+    });
+
+    return QMetaType::Type(types.values[kindOf(arrayElement(oid))]);
+}
+
+static QVariant readArray(const char * data, qint32 size, const Codec::Decoder & decoder)
+{
+    QVariantList values;
+
+    if(size < ArrayHeaderSize) return values;
+
+    qint32 dimensions = qFromBigEndian<qint32>(data);
+    if(dimensions < 0 || dimensions > ArrayMaxDimensions) return values;
+    if(size < ArrayHeaderSize + dimensions * 2 * qint32(sizeof(qint32))) return values;
+
+    const char * pos = data + ArrayHeaderSize + dimensions * 2 * sizeof(qint32), * end = data + size;
+    const qint64 count = arrayCount(data, dimensions, (end - pos) / qint64(sizeof(qint32)));
+    if(count < 0) return values;
+
+    values.reserve(count);
+
+    for(qint64 i = 0; i < count; i++)
+    {
+        if(end - pos < qint64(sizeof(qint32))) return QVariantList();
+
+        qint32 length = qFromBigEndian<qint32>(pos);
+        pos += sizeof(qint32);
+
+        if(length < 0)
+        {
+           values.append(QVariant());
+           continue;
+        }
+
+        if(length > end - pos) return QVariantList();
+
+        values.append(decoder(pos, length));
+        pos += length;
     }
+
+    return values;
 }
 
-void Connection::rowDescription(const char * data)
+static bool writeArray(QByteArray & out, quint32 oid, const QVariant & value, const Codec::Encoder & encoder)
 {
-    constexpr auto toVariants = VariantValues<QMetaType::Type>(
+    if(!value.canConvert<QVariantList>()) return false;
+
+    const QSequentialIterable iterable = value.value<QSequentialIterable>();
+    qint32 count = 0;
+
+    int start = out.size();
+    const qint32 header[] = {qToBigEndian(qint32(1)), 0, qToBigEndian(qint32(oid)), 0, qToBigEndian(qint32(1))};
+    out.append(reinterpret_cast<const char *>(header), sizeof(header));
+
+    for(const QVariant & v : iterable)
     {
-       {BOOL,QMetaType::Bool},
-       {INT2,QMetaType::Short},
-       {INT4,QMetaType::Int},
-       {INT8,QMetaType::LongLong},
-       {FLOAT4,QMetaType::Float},
-       {FLOAT8,QMetaType::Double},
-       {DATE,QMetaType::QDate},
-       {TIME,QMetaType::QTime},
-       {TIMETZ,QMetaType::QDateTime},
-       {TIMESTAMP,QMetaType::QDateTime},
-       {BYTEA,QMetaType::QByteArray},
-       {TEXT,QMetaType::QString},
-       {UUID,QMetaType::QUuid}
-    });
+        qsizetype at = out.size();
+        out.append(sizeof(quint32), 0);
 
-    Query * query = _tasks.head();
-    quint16 fieldCount = qFromBigEndian<quint16>(data), i = 0;
+        if(!encoder(out, v))
+        {
+           out.truncate(start);
+           return false;
+        }
 
-    for(quint32 pos = sizeof (quint16); i < fieldCount; i++)
+        quint32 size = qToBigEndian(quint32(out.size() - at - sizeof(quint32)));
+        std::memcpy(out.data() + at, &size, sizeof(quint32));
+        count++;
+    }
+
+    if(count == 0)
     {
-        Field field;
-        QLatin1String name(data + pos);
-        field._name = name;
+       out.truncate(start);
+       const qint32 empty[] = {0, 0, qToBigEndian(qint32(oid))};
+       out.append(reinterpret_cast<const char *>(empty), sizeof(empty));
+    }
+    else
+    {
+       count = qToBigEndian(count);
+       std::memcpy(out.data() + start + 3 * sizeof(qint32), &count, sizeof(qint32));
+    }
 
-        pos += name.size();
-        pos++;
+    return true;
+}
 
-        field._tableOID = qFromBigEndian<quint32>(data + pos);
-        pos += sizeof (quint32);
-        field._columnIndex = qFromBigEndian<quint16>(data + pos);
-        pos += sizeof (quint16);
-        field._typeOID = qFromBigEndian<quint32>(data + pos);
+//--------------------------------------------------------------------------------------------------------
 
-        if(toVariants.size() < field._typeOID) field._type = QMetaType::UnknownType;
-        else field._type = toVariants.values[field._typeOID];
+#define TcpPacketSize 0xFFFF
+#define MinimumPackageSize 0x05
 
-        pos += sizeof (quint32);
-        field._typeSize = qFromBigEndian<qint16>(data + pos);
-        pos += sizeof (qint16);
-        field._typeModifier = qFromBigEndian<qint32>(data + pos);
-        pos += sizeof (qint32);
-        field._formatType = qFromBigEndian<quint16>(data + pos);
-        pos += sizeof (quint16);
+Connection::Connection(QObject * parent) : QObject(parent), _typesQuery(new Query(this, this)), _drainQuery(new Query(this, this))
+{
+    _bufferOut.reserve(TcpPacketSize);
+    connect(_typesQuery, &Query::executeFinished, this, &Connection::typesFinished);
+    connect(_typesQuery, &Query::error, this, &Connection::error);
+    connect(&_socket, &QTcpSocket::connected, this, &Connection::makeStarupMessage);
+    connect(&_socket, &QTcpSocket::readyRead, this, &Connection::analyzePacket);
+    connect(&_socket, &QTcpSocket::disconnected, this, &Connection::close);
+    connect(&_socket, &QAbstractSocket::errorOccurred, this, [this](QAbstractSocket::SocketError)
+    {
+        Message e;
+        e._message = _socket.errorString();
+        emit error(e);
 
-        query->_fields.append(std::move(field));
-    }
+        if(_socket.state() == QAbstractSocket::UnconnectedState) close();
+    });
 }
 
-void Connection::preparedParametrs(const char * data, quint32 size)
+Connection::~Connection()
 {
-    for(int i = 0; i < qFromBigEndian<quint16>(data); i++) _tasks.head()->addPreparedParametr(qFromBigEndian<quint32>(data + sizeof(quint16) + i * sizeof(quint32)));
+    close();
 }
 
-void Connection::dataRow(const char * data, quint32 size)
+bool Connection::isConnect()
 {
-    _tasks.head()->addDataRow(data + sizeof (quint16), size - sizeof (quint16));
+    return _ready;
 }
 
-void Connection::makeStarupMessage()
+void Connection::connection(const QHostAddress & address, quint16 port, const QString & user, const QString & password, const QString & database)
 {
-    const quint16 ProtocolVersion[] = {qToBigEndian(quint16(0x03)), 0x00};
-    const char user[] = "user", database[] = "database";
+    close();
 
-    constexpr int sz = sizeof (quint32) + sizeof (ProtocolVersion) + sizeof (user) + 2;
-    quint32 size = sz + _user.size();
+    _user = user.toUtf8();
+    _password = password.toUtf8();
+    _database = database.toUtf8();
 
-    if(_database.size() > 0)
+    startCapture();
+    _socket.connectToHost(address, port);
+}
+
+void Connection::connection(QIODevice * device, const QString & user, const QString & password, const QString & database)
+{
+    close();
+
+    _user = user.toUtf8();
+    _password = password.toUtf8();
+    _database = database.toUtf8();
+
+    if(!device->isOpen())
     {
-       size += sizeof (database) + _database.size();
-       size++;
+       Message e;
+       e._message = tr("Device is not open");
+       emit error(e);
+       return;
     }
 
-    size = qToBigEndian(size);
-    _bufferOut.append(reinterpret_cast<char *>(&size), sizeof (size));
-    _bufferOut.append(reinterpret_cast<const char *>(&ProtocolVersion), sizeof (ProtocolVersion));
-    _bufferOut.append(user, sizeof (user));
-    _bufferOut.append(_user);
-    _bufferOut.append(char(0));
+    _device = device;
+    startCapture();
+    connect(_device, &QIODevice::readyRead, this, &Connection::analyzePacket);
+    connect(_device, &QIODevice::aboutToClose, this, &Connection::close);
+    connect(_device, &QObject::destroyed, this, [this]()
+    {
+        _device = &_socket;
+        close();
+    });
 
-    if(_database.size() > 0)
+    makeStarupMessage();
+}
+
+void Connection::registerType(quint32 oid, const Codec & codec)
+{
+    auto shared = QSharedPointer<const Codec>::create(codec);
+    _oidCodecs.insert(oid, shared);
+    _codecs.insert(oid, shared);
+    _descriptions.clear();
+}
+
+void Connection::registerType(const QString & name, const Codec & codec)
+{
+    _namedCodecs.insert(name, QSharedPointer<const Codec>::create(codec));
+    if(!_ready) return;
+
+    if(_tasks.contains(_typesQuery)) _typesStale = true;
+    else
     {
-       _bufferOut.append(database, sizeof (database));
-       _bufferOut.append(_database);
+       resolveTypes();
+       addQuery(_typesQuery);
+    }
+}
+
+QIODevice * Connection::capture() const
+{
+    return _capture;
+}
+
+void Connection::setCapture(QIODevice * device)
+{
+    _capture = device;
+    if(device == nullptr) _capturing = false;
+}
+
+void Connection::startCapture()
+{
+    _capturing = !_capture.isNull() && _capture->isWritable();
+    if(!_capturing) return;
+
+    const qint64 epoch = qToBigEndian(QDateTime::currentMSecsSinceEpoch());
+    _capture->write(CaptureMagic, sizeof (CaptureMagic) - 1);
+    _capture->write(reinterpret_cast<const char *>(&epoch), sizeof (epoch));
+    _captureClock.start();
+}
+
+void Connection::record(char direction, const char * data, qint64 size)
+{
+    char header[CaptureFrameSize];
+    const qint64 nsecs = qToBigEndian(_captureClock.nsecsElapsed());
+    const quint32 length = qToBigEndian(quint32(size));
+
+    header[0] = direction;
+    std::memcpy(header + 1, &nsecs, sizeof (nsecs));
+    std::memcpy(header + 1 + sizeof (nsecs), &length, sizeof (length));
+
+    if(_capture.isNull() || _capture->write(header, CaptureFrameSize) != CaptureFrameSize || _capture->write(data, size) != size) _capturing = false;
+}
+
+bool Connection::isPaused() const
+{
+    return _paused;
+}
+
+void Connection::pause()
+{
+    if(_paused) return;
+
+    _paused = true;
+    if(_device == &_socket) _socket.setReadBufferSize(TcpPacketSize);
+}
+
+void Connection::resume()
+{
+    if(!_paused) return;
+
+    _paused = false;
+    if(_device == &_socket) _socket.setReadBufferSize(0);
+    if(!_bufferIn.isEmpty() || _device->bytesAvailable() > 0) QTimer::singleShot(0, this, &Connection::analyzePacket);
+}
+
+qint64 Connection::send(const char * data, qint64 size)
+{
+    if(_capturing) record(CaptureWrite, data, size);
+    return _device->write(data, size);
+}
+
+qint64 Connection::send(const QByteArray & data)
+{
+    if(_capturing) record(CaptureWrite, data.constData(), data.size());
+    return _device->write(data);
+}
+
+qint64 Connection::memoryUsage() const
+{
+    return _memoryUsed;
+}
+
+qint64 Connection::memoryPeak() const
+{
+    return _memoryPeak;
+}
+
+void Connection::setMemoryLimits(qint64 soft, qint64 hard)
+{
+    _memorySoft = soft;
+    _memoryHard = hard;
+    _memoryWarned = false;
+}
+
+void Connection::account(qint64 delta)
+{
+    _memoryUsed += delta;
+    _memoryPeak = qMax(_memoryPeak, _memoryUsed);
+
+    if(_memorySoft <= 0 || _memoryUsed < _memorySoft)
+    {
+       _memoryWarned = false;
+       return;
+    }
+
+    if(_memoryWarned) return;
+
+    _memoryWarned = true;
+    emit memoryWarning(_memoryUsed);
+}
+
+void Connection::cancel()
+{
+    if(!_ready || _pid == 0) return;
+
+    if(_device != &_socket)
+    {
+       Message e;
+       e._message = tr("Cancel requests are not supported on a device transport");
+       emit error(e);
+       return;
+    }
+
+    const quint32 request[] = {qToBigEndian(quint32(16)), qToBigEndian(quint32(CancelRequestCode)), qToBigEndian(_pid), qToBigEndian(_key)};
+    const QByteArray packet(reinterpret_cast<const char *>(request), sizeof(request));
+
+    QTcpSocket * socket = new QTcpSocket(this);
+
+    connect(socket, &QTcpSocket::connected, socket, [socket, packet](){ socket->write(packet); });
+    connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    connect(socket, &QAbstractSocket::errorOccurred, socket, &QObject::deleteLater);
+
+    socket->connectToHost(_socket.peerAddress(), _socket.peerPort());
+}
+
+void Connection::resolveTypes()
+{
+    QStringList names;
+    for(auto it = _namedCodecs.cbegin(); it != _namedCodecs.cend(); ++it) names.append(QString(it.key()).replace('\'', "''").prepend('\'').append('\''));
+
+    _typesQuery->clear();
+    _typesQuery->_prepare = false;
+    _typesQuery->_lastQuery = "select x.name, t.oid::int8, t.typarray::int8 from pg_catalog.unnest(array[" + names.join(',') + "]::text[]) as x(name) "
+                              "left join pg_catalog.pg_type t on t.oid = pg_catalog.to_regtype(x.name)";
+    _typesStale = false;
+}
+
+void Connection::typesFinished()
+{
+    if(_typesStale)
+    {
+       resolveTypes();
+       addQuery(_typesQuery);
+       return;
+    }
+
+    _codecs = _oidCodecs;
+    _descriptions.clear();
+
+    for(int row = 0; row < _typesQuery->rowCount(); row++)
+    {
+        QString name = _typesQuery->value(row, 0).toString();
+        QVariant oid = _typesQuery->value(row, 1), typarray = _typesQuery->value(row, 2);
+        auto codec = _namedCodecs.value(name);
+
+        if(codec.isNull()) continue;
+
+        if(oid.isNull())
+        {
+           Message e;
+           e._message = tr("Unknown type: ") + name;
+           emit error(e);
+           continue;
+        }
+
+        if(!_codecs.contains(oid.toUInt())) _codecs.insert(oid.toUInt(), codec);
+
+        quint32 array = typarray.toUInt();
+        if(array == 0 || _codecs.contains(array)) continue;
+
+        Codec::Decoder decoder;
+        Codec::Encoder encoder;
+        quint32 element = oid.toUInt();
+
+        if(codec->_decoder) decoder = [codec](const char * data, qint32 size) { return readArray(data, size, codec->_decoder); };
+        if(codec->_encoder) encoder = [codec, element](QByteArray & out, const QVariant & value) { return writeArray(out, element, value, codec->_encoder); };
+
+        _codecs.insert(array, QSharedPointer<const Codec>::create(decoder, encoder, QMetaType::QVariantList));
+    }
+
+    emit typesResolved();
+}
+
+void Connection::taskFromQueue()
+{
+    _bufferOut.truncate(0);
+    Query * query = _tasks.head();
+
+    if(query->_prepare)
+    {
+       if(query->_prepareFinished) runBindQuery(query); else runPrepareQuery(query);
+    }
+    else if(query->_script) runScript(query);
+    else runQuery(query);
+}
+
+void Connection::endTask()
+{
+    if(_tasks.size() > 0)
+    {
+       Query * query = _tasks.dequeue();
+       const bool pending = _tasks.size() > 0;
+       query->_aborted = false;
+       query->_result._d->finish();
+
+       if(query->_prepare && !query->_prepareFinished)
+       {
+          query->_prepareFinished = true;
+          emit query->prepareFinished();
+       }
+       else emit query->executeFinished();
+
+       if(pending && _tasks.size() > 0) taskFromQueue();
+    }
+}
+
+void Connection::failTask(const Message & e)
+{
+    _bufferOut.truncate(0);
+    Query * query = _tasks.dequeue();
+    const bool pending = _tasks.size() > 0;
+    emit query->error(e);
+
+    if(pending && _tasks.size() > 0) taskFromQueue();
+}
+
+void Connection::addQuery(Query * query)
+{
+    if((_device == &_socket) ? _socket.state() == QAbstractSocket::UnconnectedState : !_device->isOpen())
+    {
+       Message e;
+       e._message = tr("No connection to the server");
+       emit query->error(e);
+       return;
+    }
+
+    _tasks.enqueue(query);
+    if(_ready && _pendingSyncs == 0 && _tasks.head() == query) taskFromQueue();
+}
+
+void Connection::runQuery(Query * query)
+{
+    const char BDES_msgs[] = {0x42, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x44,
+                              0x00, 0x00, 0x00, 0x06, 0x50, 0x00, 0x45, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00,
+                              0x53, 0x00, 0x00, 0x00, 0x04};
+
+    constexpr quint32 sz = sizeof(quint32) + 4;
+    QByteArray data = query->_lastQuery.toUtf8();
+    quint32 size = sz + data.size();
+
+    size = qToBigEndian(size);
+
+    _bufferOut.append(Parse);
+    _bufferOut.append(reinterpret_cast<char *>(&size), sizeof(quint32));
+    _bufferOut.append(char(0));
+    _bufferOut.append(data);
+    _bufferOut.append(3, 0);
+
+    if(query->_fetchSize > 0)
+    {
+       _bufferOut.append(BDES_msgs, sizeof (BDES_msgs) - ExecuteSyncSize);
+       appendPortalExecute(_bufferOut, query);
+    }
+    else _bufferOut.append(BDES_msgs, sizeof (BDES_msgs));
+
+    send(_bufferOut);
+}
+
+void Connection::runScript(Query * query)
+{
+    QByteArray data = query->_lastQuery.toUtf8();
+    quint32 size = qToBigEndian(quint32(sizeof (quint32) + data.size() + 1));
+
+    _bufferOut.append(char(SimpleQuery));
+    _bufferOut.append(reinterpret_cast<char *>(&size), sizeof(quint32));
+    _bufferOut.append(data);
+    _bufferOut.append(char(0));
+
+    send(_bufferOut);
+}
+
+void Connection::appendPortalExecute(QByteArray & out, Query * query)
+{
+    const char flush[] = {Flush, 0x00, 0x00, 0x00, 0x04};
+    quint32 size = qToBigEndian(quint32(sizeof (quint32) + 1 + sizeof (qint32)));
+    qint32 rows = qToBigEndian(qint32(query->_fetchSize));
+
+    out.append(char(Execute));
+    out.append(reinterpret_cast<char *>(&size), sizeof(quint32));
+    out.append(char(0));
+    out.append(reinterpret_cast<char *>(&rows), sizeof(qint32));
+    out.append(flush, sizeof (flush));
+
+    query->_portal = PortalActive;
+}
+
+void Connection::fetchPortal(Query * query)
+{
+    _bufferOut.truncate(0);
+    appendPortalExecute(_bufferOut, query);
+    send(_bufferOut);
+}
+
+void Connection::closePortal(Query * query)
+{
+    const char close_sync[] = {Close, 0x00, 0x00, 0x00, 0x06, Portal, 0x00, Sync, 0x00, 0x00, 0x00, 0x04};
+
+    query->_portal = PortalNone;
+    send(close_sync, sizeof (close_sync));
+}
+
+void Connection::discardPortal(Query * query)
+{
+    closePortal(query);
+    _tasks.removeOne(query);
+    _pendingSyncs++;
+}
+
+void Connection::removeQuery(Query * query)
+{
+    const int index = _tasks.indexOf(query);
+    if(index < 0) return;
+
+    if(index > 0 || !_ready || _pendingSyncs > 0)
+    {
+       _tasks.removeAt(index);
+       return;
+    }
+
+    _drainQuery->_portal = query->_portal;
+    _drainQuery->_aborted = true;
+    _tasks[0] = _drainQuery;
+}
+
+void Connection::portalSuspended()
+{
+    if(_tasks.size() == 0) return;
+
+    Query * query = _tasks.head();
+
+    if(query == _drainQuery)
+    {
+       discardPortal(query);
+       return;
+    }
+
+    query->_portal = PortalHeld;
+    query->_result._d->finish();
+    emit query->executeFinished();
+}
+
+void Connection::runPrepareQuery(Query * query)
+{
+    const unsigned char sync[] = {0x53, 0x00, 0x00, 0x00, 0x04};
+
+    constexpr quint32 sz = sizeof(quint32) + 4;
+    QByteArray data = query->_lastQuery.toUtf8();
+    quint32 size = sz + query->_stmtName.size() + data.size();
+
+    size = qToBigEndian(size);
+
+    _bufferOut.append(Parse);
+    _bufferOut.append(reinterpret_cast<char *>(&size), sizeof(quint32));
+    _bufferOut.append(query->_stmtName);
+    _bufferOut.append(char(0));
+    _bufferOut.append(data);
+    _bufferOut.append(3, 0);
+
+    size = sizeof(quint32) + query->_stmtName.size() + 2;
+    size = qToBigEndian(size);
+
+    _bufferOut.append(char(Describe));
+    _bufferOut.append(reinterpret_cast<char *>(&size), sizeof(quint32));
+    _bufferOut.append(char(Statement));
+    _bufferOut.append(query->_stmtName);
+    _bufferOut.append(char(0));
+
+    _bufferOut.append(reinterpret_cast<const char *>(&sync), sizeof(sync));
+    send(_bufferOut);
+}
+
+#define ParameterUnbound 0
+#define ParameterVariant 1
+#define ParameterEncoded 2
+#define ParameterClean 3
+#define LargeParameterSize 0x10000
+
+static QByteArray ownedBytes(const QByteArray & value)
+{
+#if QT_VERSION >= 0x060000
+    if(value.data_ptr().isMutable()) return value;
+#else
+    if(const_cast<QByteArray &>(value).data_ptr()->isMutable()) return value;
+#endif
+    return QByteArray(value.constData(), value.size());
+}
+
+static bool encodeParameter(QByteArray & out, quint32 oid, const Codec * codec, const QVariant & value)
+{
+    constexpr auto types = GotoPointers<KindCount>(
+
+      &&_default,
+
+      {
+        {BoolKind, &&_BOOL},
+        {Int2Kind, &&_INT2},
+        {Int4Kind, &&_INT4},
+        {Int8Kind, &&_INT8},
+        {Float4Kind, &&_FLOAT4},
+        {Float8Kind, &&_FLOAT8},
+        {DateKind, &&_DATE},
+        {TimeKind, &&_TIME},
+        {TimeTzKind, &&_TIMETZ},
+        {TimestampKind, &&_TIMESTAMP},
+        {ByteaKind, &&_BYTEA},
+        {TextKind, &&_TEXT},
+        {UuidKind, &&_UUID},
+        {NumericKind, &&_NUMERIC},
+        {JsonKind, &&_JSON},
+        {ArrayKind, &&_ARRAY},
+        {CodecKind, &&_CODEC}
+      }
+
+    );
+
+    goto *types.pointers[(codec != nullptr) ? quint8(CodecKind) : kindOf(oid)];
+
+    _BOOL:
+     Binary<bool>::write(out, value.toBool());
+     return true;
+
+    _INT2:
+     Binary<qint16>::write(out, qint16(value.toInt()));
+     return true;
+
+    _INT4:
+     Binary<qint32>::write(out, value.toInt());
+     return true;
+
+    _INT8:
+     Binary<qint64>::write(out, value.toLongLong());
+     return true;
+
+    _FLOAT4:
+     Binary<float>::write(out, value.toFloat());
+     return true;
+
+    _FLOAT8:
+     Binary<double>::write(out, value.toDouble());
+     return true;
+
+    _DATE:
+     Binary<QDate>::write(out, value.toDate());
+     return true;
+
+    _TIME:
+     Binary<QTime>::write(out, value.toTime());
+     return true;
+
+    _TIMETZ:
+    {
+      QDateTime dt = value.toDateTime();
+      Binary<qint64>::write(out, qint64(dt.time().msecsSinceStartOfDay())*1000);
+      Binary<qint32>::write(out, -dt.offsetFromUtc());
+    }
+    return true;
+
+    _TIMESTAMP:
+     Binary<QDateTime>::write(out, value.toDateTime());
+     return true;
+
+    _BYTEA:
+    _TEXT:
+    {
+      const QByteArray v = value.toByteArray();
+      if(out.isEmpty()) out = ownedBytes(v); else out.append(v);
+    }
+    return true;
+
+    _UUID:
+     out.append(value.toUuid().toRfc4122());
+     return true;
+
+    _NUMERIC:
+    {
+      bool ok = true;
+      const Numeric v = (value.userType() == qMetaTypeId<Numeric>()) ? value.value<Numeric>() : Numeric::fromString(value.toString(), &ok);
+
+      if(!ok || v.isNull()) return false;
+      Binary<Numeric>::write(out, v);
+    }
+    return true;
+
+    _JSON:
+     if(oid == _JSONBOID) out.append(char(JsonbVersion));
+     out.append(jsonBinary(value));
+     return true;
+
+    _ARRAY:
+     return writeArray(out, arrayElement(oid), value);
+
+    _CODEC:
+     return codec->encoder()(out, value);
+
+    _default:
+     return false;
+}
+
+void Connection::runBindQuery(Query * query)
+{
+    const char ES_msgs[] = {0x45, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x53, 0x00, 0x00, 0x00, 0x04};
+    const char bin_format[] = {0x00, 0x01, 0x00, 0x01};
+    const char * const msg = "The binding does not support the type OID: ";
+
+    const int values = query->_preparedParametrs.size();
+    QByteArray & frame = query->_bindTemplate;
+    bool rebuild = frame.isEmpty();
+
+    for(int i = 0; i < values; i++)
+    {
+        quint8 & state = query->_parameterState[i];
+        QByteArray & data = query->_parameterData[i];
+
+        if(state == ParameterUnbound)
+        {
+           Message e;
+           e._message += tr("Parameter is not bound: ") + QString::number(i + 1);
+           failTask(e);
+           return;
+        }
+
+        if(state == ParameterVariant)
+        {
+           data.truncate(0);
+
+           if(!encodeParameter(data, query->_preparedParametrs[i], query->_parameterCodecs[i].data(), query->_bindValues[i]))
+           {
+              Message e;
+              e._message += tr(msg) + QString::number(query->_preparedParametrs[i]);
+              failTask(e);
+              return;
+           }
+
+           state = ParameterEncoded;
+        }
+
+        if(state == ParameterEncoded && !rebuild)
+        {
+           rebuild = qFromBigEndian<qint32>(frame.constData() + query->_parameterOffsets[i] - sizeof(qint32)) != data.size();
+        }
+    }
+
+    if(rebuild)
+    {
+       frame.truncate(0);
+       query->_parameterOffsets.resize(values);
+
+       frame.append(Bind);
+       frame.append(sizeof(quint32), 0);
+       frame.append(char(0));
+       frame.append(query->_stmtName);
+       frame.append(char(0));
+
+       quint16 count = qToBigEndian(quint16(values)), type = qToBigEndian(quint16(1));
+
+       frame.append(reinterpret_cast<char *>(&count), sizeof(quint16));
+       for(int i = 0; i < values; i++) frame.append(reinterpret_cast<char *>(&type), sizeof(quint16));
+       frame.append(reinterpret_cast<char *>(&count), sizeof(quint16));
+
+       qint64 large = 0;
+
+       for(int i = 0; i < values; i++)
+       {
+           const QByteArray & data = query->_parameterData[i];
+           quint32 sz = qToBigEndian(quint32(data.size()));
+
+           frame.append(reinterpret_cast<char *>(&sz), sizeof(quint32));
+           query->_parameterOffsets[i] = frame.size();
+
+           if(data.size() < LargeParameterSize) frame.append(data);
+           else large += data.size();
+       }
+
+       frame.append(bin_format, sizeof(bin_format));
+
+       quint32 size = qToBigEndian(quint32(frame.size() + large - 1));
+       std::memcpy(frame.data() + 1, &size, sizeof(quint32));
+
+       frame.append(ES_msgs, sizeof (ES_msgs));
+    }
+    else
+    {
+       char * dst = frame.data();
+
+       for(int i = 0; i < values; i++)
+       {
+           if(query->_parameterState[i] != ParameterEncoded) continue;
+
+           const QByteArray & data = query->_parameterData[i];
+           if(data.size() < LargeParameterSize) std::memcpy(dst + query->_parameterOffsets[i], data.constData(), data.size());
+       }
+    }
+
+    qsizetype from = 0;
+
+    for(int i = 0; i < values; i++)
+    {
+        const QByteArray & data = query->_parameterData[i];
+        if(query->_parameterState[i] == ParameterEncoded) query->_parameterState[i] = ParameterClean;
+
+        if(data.size() < LargeParameterSize) continue;
+
+        send(frame.constData() + from, query->_parameterOffsets[i] - from);
+        send(data);
+        from = query->_parameterOffsets[i];
+    }
+
+    const qsizetype end = frame.size() - ((query->_fetchSize > 0) ? ExecuteSyncSize : 0);
+    send(frame.constData() + from, end - from);
+
+    if(query->_fetchSize > 0)
+    {
+       QByteArray execute;
+       appendPortalExecute(execute, query);
+       send(execute);
+    }
+}
+
+void Connection::close()
+{
+    const unsigned char Termination[] = {0x58, 0x00, 0x00, 0x00, 0x04};
+
+    _pid = 0;
+    _key = 0;
+
+    bool ready = _ready;
+    _auth_success = false;
+    _ready = false;
+
+    account(-_bufferIn.size());
+    _bufferIn.clear();
+
+    _streamLeft = 0;
+    _skipLeft = 0;
+    _pendingSyncs = 0;
+
+    if(_paused)
+    {
+       _paused = false;
+       _socket.setReadBufferSize(0);
+    }
+    _streamRow.clear();
+
+    if(_device != &_socket)
+    {
+       QIODevice * device = _device;
+       _device = &_socket;
+       disconnect(device, nullptr, this, nullptr);
+
+       if(ready && device->isOpen()) device->write(reinterpret_cast<const char *>(Termination), sizeof (Termination));
+    }
+    else if(_socket.state() == QAbstractSocket::ConnectedState)
+    {
+       if(ready)
+       {
+          _socket.write(reinterpret_cast<const char *>(Termination), sizeof (Termination));
+          _socket.waitForBytesWritten();
+       }
+       _socket.close();
+    }
+    else if(_socket.state() != QAbstractSocket::UnconnectedState) _socket.abort();
+
+    if(_tasks.size() > 0)
+    {
+       Message e;
+       e._message = tr("Connection closed");
+
+       QVector<QPointer<Query>> tasks;
+       for(Query * query : std::as_const(_tasks)) if(query != _drainQuery) tasks.append(query);
+       _tasks.clear();
+
+       for(const QPointer<Query> & query : std::as_const(tasks)) if(!query.isNull()) emit query->error(e);
+    }
+
+    _capturing = false;
+    if(ready) emit disconnected();
+}
+
+void Connection::errorOrNoticeResponse(const char * data, quint32 size, ErrorOrNotice type)
+{
+    quint32 pos = 0;
+    QLatin1String v, c, m;
+
+    do
+    {
+       char type = *(data + pos);
+
+       pos++;
+       QLatin1String temp(data + pos);
+       pos += temp.size();
+       pos++;
+
+       switch (type)
+       {
+               case ErrorOrNoticeType: v = temp;
+               break;
+               case ErrorOrNoticeCode: c = temp;
+               break;
+               case ErrorOrNoticeMessage: m = temp;
+               break;
+       }
+    }
+    while(pos < size || (v.size() == 0 || c.size() == 0 || m.size() == 0));
+
+    if(type == ErrorOrNotice::Error)
+    {
+       Message e;
+       e._importance = v;
+       e._code = c;
+       e._message = utf8String(m.data(), m.size());
+
+       if(_tasks.size() > 0)
+       {
+          if(_tasks.head()->_portal != PortalNone) closePortal(_tasks.head());
+          if(!_tasks.head()->_aborted) emit _tasks.head()->error(e);
+       }
+       else emit error(e);
+    }
+    else
+    {
+       Message n;
+       n._importance = v;
+       n._code = c;
+       n._message = utf8String(m.data(), m.size());
+
+       if(_tasks.size() > 0) emit _tasks.head()->notice(n);
+       else emit notice(n);
+    }
+}
+
+bool Connection::authentication(const char * data)
+{
+    quint32 type = qFromBigEndian<quint32>(data);
+
+    if(type == MD5password)
+    {
+       QByteArray hash = "md5" + QCryptographicHash::hash(
+                                  QCryptographicHash::hash(_password+_user,
+                                   QCryptographicHash::Md5).toHex() + QByteArray(data + 4, 4),
+                                    QCryptographicHash::Md5).toHex();
+
+       _bufferOut.append(PasswordMessage);
+
+       quint32 size = sizeof(quint32) + hash.size();
+       size++;
+
+       size = qToBigEndian(size);
+
+       _bufferOut.append(reinterpret_cast<char *>(&size), sizeof (size));
+       _bufferOut.append(hash);
+       _bufferOut.append(char(0));
+
+       if(_capturing)
+       {
+          QByteArray redacted = _bufferOut;
+          redacted.replace(redacted.size() - hash.size() - 1, hash.size(), QByteArray(hash.size(), '*'));
+          record(CaptureWrite, redacted.constData(), redacted.size());
+       }
+
+       _device->write(_bufferOut);
+       _bufferOut.truncate(0);
+
+       return true;
+    }
+    else if(type == AuthenticationSucces)
+    {
+       _auth_success = true;
+       return true;
+    }
+
+    return false;
+}
+
+void Connection::parameterStatus(const char * data)
+{
+    QLatin1String key(data);
+    data++;
+    _parametersStatus[key] = QLatin1String(data + key.size());
+}
+
+void Connection::backendKeyData(const char * data)
+{
+    _pid = qFromBigEndian<quint32>(data);
+    _key = qFromBigEndian<quint32>(data + sizeof (quint32));
+}
+
+void Connection::readyForQuery(const char * data)
+{
+    if(!_ready)
+    {
+       _ready = true;
+
+       if(!_namedCodecs.isEmpty() && _replication == nullptr && !_tasks.contains(_typesQuery))
+       {
+          resolveTypes();
+          _tasks.prepend(_typesQuery);
+       }
+
+       const bool pending = _tasks.size() > 0;
+       emit connected();
+       if(pending && _ready && _tasks.size() > 0) taskFromQueue();
+       return;
+    }
+
+    if(_pendingSyncs > 0)
+    {
+       if(--_pendingSyncs == 0 && _tasks.size() > 0) taskFromQueue();
+       return;
+    }
+
+    switch(char(*data))
+    {
+        case Idle: endTask();
+        break;
+        case Transaction: endTask();
+        break;
+        case Exit:
+        break;
+    }
+}
+
+void Connection::rowDescription(const char * data, quint32 size)
+{
+    Query * query = _tasks.head();
+    if(query->_script) query->startStatement(); else query->detachShared();
+
+    Result::Data & result = *query->_result._d;
+    auto cached = query->_script ? _descriptions.constEnd() : _descriptions.constFind(QByteArray::fromRawData(data, size));
+
+    if(cached != _descriptions.constEnd())
+    {
+       result.fields = cached->_d->fields;
+       result.names = cached->_d->names;
+       return;
+    }
+
+    quint16 fieldCount = qFromBigEndian<quint16>(data), i = 0;
+    result.fields.clear();
+    result.names.clear();
+    result.fields.reserve(fieldCount);
+
+    for(quint32 pos = sizeof (quint16); i < fieldCount; i++)
+    {
+        Field field;
+        qint32 length = qint32(std::strlen(data + pos));
+        field._name = utf8String(data + pos, length);
+
+        pos += length;
+        pos++;
+
+        field._tableOID = qFromBigEndian<quint32>(data + pos);
+        pos += sizeof (quint32);
+        field._columnIndex = qFromBigEndian<quint16>(data + pos);
+        pos += sizeof (quint16);
+        field._typeOID = qFromBigEndian<quint32>(data + pos);
+        describeField(field);
+
+        pos += sizeof (quint32);
+        field._typeSize = qFromBigEndian<qint16>(data + pos);
+        pos += sizeof (qint16);
+        field._typeModifier = qFromBigEndian<qint32>(data + pos);
+        pos += sizeof (qint32);
+        field._formatType = query->_script ? qFromBigEndian<quint16>(data + pos) : 1;
+        pos += sizeof (quint16);
+
+        if(field._formatType == 0)
+        {
+           field._kind = TextKind;
+           field._type = QMetaType::QString;
+           field._codec.reset();
+        }
+
+        if(!result.names.contains(field._name)) result.names.insert(field._name, i);
+        result.fields.append(std::move(field));
+    }
+
+    if(query->_script) return;
+    if(_descriptions.size() >= DescriptionCacheSize) _descriptions.clear();
+
+    Result description;
+    description._d->fields = result.fields;
+    description._d->names = result.names;
+    _descriptions.insert(QByteArray(data, size), description);
+}
+
+void Connection::describeField(Field & field) const
+{
+    constexpr auto toVariants = VariantValues<QMetaType::Type, KindCount>(
+    {
+       {{BoolKind},QMetaType::Bool},
+       {{Int2Kind},QMetaType::Short},
+       {{Int4Kind},QMetaType::Int},
+       {{Int8Kind},QMetaType::LongLong},
+       {{Float4Kind},QMetaType::Float},
+       {{Float8Kind},QMetaType::Double},
+       {{DateKind},QMetaType::QDate},
+       {{TimeKind},QMetaType::QTime},
+       {{TimeTzKind},QMetaType::QDateTime},
+       {{TimestampKind},QMetaType::QDateTime},
+       {{ByteaKind},QMetaType::QByteArray},
+       {{TextKind},QMetaType::QString},
+       {{UuidKind},QMetaType::QUuid},
+       {{NumericKind},QMetaType::User},
+       {{JsonKind},QMetaType::QJsonDocument},
+       {{ArrayKind},QMetaType::QVariantList}
+    });
+
+    field._kind = kindOf(field._typeOID);
+    field._type = toVariants.values[field._kind];
+
+    if(field._kind == ArrayKind) field._type = arrayType(field._typeOID);
+    else if(field._kind == NumericKind) field._type = QMetaType::Type(qMetaTypeId<Numeric>());
+
+    auto codec = _codecs.constFind(field._typeOID);
+
+    if(codec != _codecs.constEnd() && (*codec)->_decoder)
+    {
+       field._codec = *codec;
+       field._kind = CodecKind;
+       field._type = field._codec->_type;
+    }
+}
+
+void Connection::preparedParametrs(const char * data, quint32 size)
+{
+    for(int i = 0; i < qFromBigEndian<quint16>(data); i++) _tasks.head()->addPreparedParametr(qFromBigEndian<quint32>(data + sizeof(quint16) + i * sizeof(quint32)));
+}
+
+void Connection::dataRow(const char * data, quint32 size)
+{
+    _tasks.head()->addDataRow(data + sizeof (quint16), size - sizeof (quint16));
+}
+
+void Connection::commandCompletion(const char * data, quint32 size)
+{
+    if(_tasks.size() == 0) return;
+
+    Query * query = _tasks.head();
+    if(query->_script) query->startStatement(); else query->detachShared();
+
+    query->_result._d->tag = (size > 0) ? QByteArray(data, qint32(size) - 1) : QByteArray();
+    query->_result._d->finish();
+
+    if(query->_script)
+    {
+       query->_results.append(query->_result);
+       query->_statementDone = true;
+    }
+}
+
+qint64 Connection::streamRow(const char * data, qint64 size)
+{
+    Query * query = _tasks.head();
+    qint64 pos = 0;
+    size = qMin(size, _streamLeft);
+
+    while(pos < size)
+    {
+        if(_streamColumn < 0)
+        {
+           if(size - pos < qint64(sizeof (quint16))) break;
+
+           pos += sizeof (quint16);
+           _streamColumn = 0;
+           continue;
+        }
+
+        auto stream = query->_streams.constFind(_streamColumn);
+        bool streamed = stream != query->_streams.constEnd();
+
+        if(_streamCell < 0)
+        {
+           if(size - pos < qint64(sizeof (qint32))) break;
+
+           qint32 length = qFromBigEndian<qint32>(data + pos);
+           pos += sizeof (qint32);
+
+           if(streamed)
+           {
+              const qint32 null = qToBigEndian(qint32(-1));
+              _streamRow.append(reinterpret_cast<const char *>(&null), sizeof (qint32));
+           }
+           else _streamRow.append(data + pos - sizeof (qint32), sizeof (qint32));
+
+           if(length < 0)
+           {
+              _streamColumn++;
+              continue;
+           }
+
+           _streamCell = length;
+        }
+
+        qint64 n = qMin<qint64>(_streamCell, size - pos);
+
+        if(streamed)
+        {
+           if(n > 0) (*stream)(query->rowCount(), data + pos, n);
+        }
+        else _streamRow.append(data + pos, n);
+
+        pos += n;
+        _streamCell -= n;
+
+        if(_streamCell == 0)
+        {
+           if(streamed) (*stream)(query->rowCount(), nullptr, 0);
+
+           _streamCell = -1;
+           _streamColumn++;
+        }
+    }
+
+    _streamLeft -= pos;
+
+    if(_streamLeft == 0)
+    {
+       query->addDataRow(_streamRow.constData(), _streamRow.size());
+       _streamRow.truncate(0);
+       _streamColumn = -1;
+    }
+
+    return pos;
+}
+
+void Connection::makeStarupMessage()
+{
+    const quint16 ProtocolVersion[] = {qToBigEndian(quint16(0x03)), 0x00};
+    const char user[] = "user", database[] = "database", replication[] = "replication\0database";
+
+    constexpr int sz = sizeof (quint32) + sizeof (ProtocolVersion) + sizeof (user) + 2;
+    quint32 size = sz + _user.size();
+
+    if(_database.size() > 0)
+    {
+       size += sizeof (database) + _database.size();
+       size++;
+    }
+
+    if(_replication != nullptr) size += sizeof (replication);
+
+    size = qToBigEndian(size);
+    _bufferOut.append(reinterpret_cast<char *>(&size), sizeof (size));
+    _bufferOut.append(reinterpret_cast<const char *>(&ProtocolVersion), sizeof (ProtocolVersion));
+    _bufferOut.append(user, sizeof (user));
+    _bufferOut.append(_user);
+    _bufferOut.append(char(0));
+
+    if(_database.size() > 0)
+    {
+       _bufferOut.append(database, sizeof (database));
+       _bufferOut.append(_database);
        _bufferOut.append(char(0));
     }
 
-    _bufferOut.append(char(0));
-    _socket.write(_bufferOut);
-    _bufferOut.truncate(0);
+    if(_replication != nullptr) _bufferOut.append(replication, sizeof (replication));
+
+    _bufferOut.append(char(0));
+    send(_bufferOut);
+    _bufferOut.truncate(0);
+}
+
+void Connection::analyzePacket()
+{
+    constexpr auto proto = GotoPointers<std::numeric_limits<quint8>::max()>(
+
+      &&_default,
+
+      {
+        {DataRow, &&_DataRow},
+        {NoData, &&_next},
+        {ParameterDescription, &&_ParameterDescription},
+        {RowDescription, &&_RowDescription},
+        {ReadyForQuery, &&_ReadyForQuery},
+        {CommandCompletion, &&_CommandCompletion},
+        {EmptyQueryResponse, &&_EmptyQueryResponse},
+        {PortalSuspended, &&_PortalSuspended},
+        {CloseComplete, &&_next},
+        {ParseComplite, &&_next},
+        {BindCompletion, &&_next},
+        {ErrorResponse, &&_ErrorResponse},
+        {NoticeResponse, &&_NoticeResponse},
+        {ParameterStatus, &&_ParameterStatus},
+        {AuthenticationRequest, &&_AuthenticationRequest},
+        {BackendKeyData, &&_BackendKeyData},
+        {NegotiateProtocolVersion, &&_NegotiateProtocolVersion},
+        {CopyBothResponse, &&_CopyBothResponse},
+        {CopyData, &&_CopyData},
+        {CopyDone, &&_CopyDone},
+      }
+    );
+
+    if(_paused) return;
+
+    quint32 pos = 0;
+    const QByteArray input = _device->readAll();
+    if(_capturing) record(CaptureRead, input.constData(), input.size());
+
+    QByteArray data = _bufferIn + input;
+    account(-_bufferIn.size());
+    _bufferIn.clear();
+
+    if(_skipLeft > 0)
+    {
+       qint64 n = qMin<qint64>(_skipLeft, data.size());
+       _skipLeft -= n;
+
+       if(_skipLeft > 0) return;
+       data.remove(0, n);
+    }
+
+    if(data.size() < MinimumPackageSize && _streamLeft == 0)
+    {
+       _bufferIn = data;
+       account(_bufferIn.size());
+       return;
+    }
+
+    do
+    {
+       if(_streamLeft > 0)
+       {
+          pos += streamRow(data.data() + pos, data.size() - pos);
+
+          if(_streamLeft > 0)
+          {
+             _bufferIn = data.mid(pos);
+             account(_bufferIn.size());
+             return;
+          }
+
+          continue;
+       }
+
+       quint32 size = qFromBigEndian<quint32>(data.data() + pos + 1);
+
+       if(data[pos] == DataRow && _tasks.size() > 0 && !_tasks.head()->_streams.isEmpty())
+       {
+          _streamLeft = size - sizeof (quint32);
+          _streamCell = -1;
+          _streamColumn = -1;
+          _streamRow.truncate(0);
+
+          pos += MinimumPackageSize;
+          continue;
+       }
+
+       if(static_cast<quint32>(data.size()) <= pos + size)
+       {
+          if(data[pos] == DataRow && _tasks.size() > 0 && _tasks.head()->exceeds(size))
+          {
+             _tasks.head()->abort(tr("Memory limit exceeded by a row of ") + QString::number(size) + tr(" bytes"));
+             _skipLeft = qint64(size) + 1 - (data.size() - pos);
+             return;
+          }
+
+          if(_memoryHard > 0 && _memoryUsed + size > _memoryHard)
+          {
+             Message e;
+             e._message = tr("Memory limit exceeded by a message of ") + QString::number(size) + tr(" bytes");
+             emit error(e);
+             close();
+             return;
+          }
+
+          _bufferIn = data.mid(pos);
+          account(_bufferIn.size());
+          return;
+       }
+
+       goto *proto.pointers[data[pos]];
+
+       _DataRow: dataRow(data.data() + pos + MinimumPackageSize, size - sizeof (quint32));
+        goto _next;
+
+       _ParameterDescription: preparedParametrs(data.data() + pos + MinimumPackageSize, size - sizeof (quint32));
+        goto _next;
+
+       _RowDescription: rowDescription(data.data() + pos + MinimumPackageSize, size - sizeof (quint32));
+        goto _next;
+
+       _ReadyForQuery: readyForQuery(data.data() + pos + MinimumPackageSize);
+        goto _next;
+
+       _CommandCompletion: commandCompletion(data.data() + pos + MinimumPackageSize, size - sizeof (quint32));
+
+       _EmptyQueryResponse:
+        if(_tasks.size() > 0 && _tasks.head()->_portal != PortalNone) closePortal(_tasks.head());
+        goto _next;
+
+       _PortalSuspended: portalSuspended();
+        goto _next;
+
+       _ErrorResponse: errorOrNoticeResponse(data.data() + pos + MinimumPackageSize, size - sizeof (quint32), ErrorOrNotice::Error);
+        goto _next;
+
+       _NoticeResponse: errorOrNoticeResponse(data.data() + pos + MinimumPackageSize, size - sizeof (quint32), ErrorOrNotice::Notice);
+        goto _next;
+
+       _ParameterStatus: parameterStatus(data.data() + pos + MinimumPackageSize);
+        goto _next;
+
+       _AuthenticationRequest:
+
+        if(!authentication(data.data() + pos + MinimumPackageSize))
+        {
+           Message e;
+           e._message = tr("Authorization error");
+           emit error(e);
+           close();
+           return;
+        }
+
+        goto _next;
+
+       _BackendKeyData : backendKeyData(data.data() + pos + MinimumPackageSize);
+        goto _next;
+
+       _CopyBothResponse:
+        if(_replication != nullptr) _replication->copyBoth();
+        goto _next;
+
+       _CopyData:
+        if(_replication != nullptr)
+        {
+           _replication->copyData(data.data() + pos + MinimumPackageSize, size - sizeof (quint32));
+
+           if(_paused)
+           {
+              _bufferIn = data.mid(pos + size + 1);
+              account(_bufferIn.size());
+              return;
+           }
+        }
+        goto _next;
+
+       _CopyDone:
+        if(_replication != nullptr) _replication->copyDone();
+        goto _next;
+
+       _NegotiateProtocolVersion :
+        {
+          Message e;
+          e._message = tr("Protocol version 3.0 is not supported");
+          emit error(e);
+          close();
+          return;
+        }
+
+        _default:
+        {
+          Message e;
+          e._message = tr("Does not support the type of message in the protocol: ") + data[pos];
+          emit error(e);
+          close();
+          return;
+        }
+
+       _next:
+       pos += size;
+       pos++;
+    }
+    while(pos + MinimumPackageSize <= static_cast<quint32>(data.size()));
+
+    if(pos != static_cast<quint32>(data.size()))
+    {
+       _bufferIn = data.mid(pos);
+       account(_bufferIn.size());
+    }
+}
+
+//Result==================================================================================================
+//========================================================================================================
+
+static quint32 binaryType(const Field & field)
+{
+    return (field.formatType() == 1) ? field.typeOID() : quint32(_TEXTOID);
+}
+
+Result::Data::~Data()
+{
+    clearRows();
+}
+
+int Result::Data::size() const
+{
+    return rows.size() + mapped;
+}
+
+const char * Result::Data::row(int index) const
+{
+    if(index < rows.size()) return rows.at(index);
+    return reinterpret_cast<const char *>(map) + spillRows.at(index - rows.size());
+}
+
+void Result::Data::finish()
+{
+    if(mapped == spillRows.size()) return;
+
+    spill->flush();
+    if(map != nullptr) spill->unmap(map);
+
+    map = spill->map(0, spill->size());
+    mapped = (map == nullptr) ? 0 : int(spillRows.size());
+}
+
+void Result::Data::clearRows()
+{
+    for(char * row : std::as_const(rows)) delete[] row;
+    rows.clear();
+
+    if(spill != nullptr)
+    {
+       if(map != nullptr) spill->unmap(map);
+       delete spill;
+    }
+
+    spill = nullptr;
+    map = nullptr;
+    mapped = 0;
+    spillRows.clear();
+}
+
+static const char hexDigits[] = "0123456789abcdef";
+
+static void appendInteger(QByteArray & out, qint64 value)
+{
+    char buffer[24];
+    char * end = std::to_chars(buffer, buffer + sizeof (buffer), value).ptr;
+    out.append(buffer, int(end - buffer));
+}
+
+static void appendFloat(QByteArray & out, double value, bool single, bool json)
+{
+    if(!std::isfinite(value))
+    {
+       if(json) out.append('"');
+       out.append(std::isnan(value) ? "NaN" : (value > 0) ? "Infinity" : "-Infinity");
+       if(json) out.append('"');
+       return;
+    }
+
+    char buffer[32];
+    char * end = single ? std::to_chars(buffer, buffer + sizeof (buffer), float(value)).ptr
+                        : std::to_chars(buffer, buffer + sizeof (buffer), value).ptr;
+    out.append(buffer, int(end - buffer));
+}
+
+static void appendPadded(QByteArray & out, qint64 value, int width)
+{
+    char buffer[20];
+    for(int i = width - 1; i >= 0; i--, value /= 10) buffer[i] = char('0' + value % 10);
+    out.append(buffer, width);
+}
+
+static void appendDate(QByteArray & out, qint32 days)
+{
+    if(days == std::numeric_limits<qint32>::max() || days == std::numeric_limits<qint32>::min())
+    {
+       out.append((days > 0) ? "infinity" : "-infinity");
+       return;
+    }
+
+    const QDate date = QDate::fromJulianDay(PostgresEpochDays + days);
+    int year = date.year();
+
+    if(year < 0)
+    {
+       out.append('-');
+       year = -year;
+    }
+
+    appendPadded(out, year, 4);
+    out.append('-');
+    appendPadded(out, date.month(), 2);
+    out.append('-');
+    appendPadded(out, date.day(), 2);
+}
+
+static void appendTime(QByteArray & out, qint64 microseconds)
+{
+    appendPadded(out, microseconds / Q_INT64_C(3600000000), 2);
+    out.append(':');
+    appendPadded(out, microseconds / 60000000 % 60, 2);
+    out.append(':');
+    appendPadded(out, microseconds / 1000000 % 60, 2);
+
+    if(microseconds % 1000000 != 0)
+    {
+       out.append('.');
+       appendPadded(out, microseconds % 1000000, 6);
+    }
+}
+
+static void appendTimestamp(QByteArray & out, qint64 microseconds, bool utc)
+{
+    if(microseconds == std::numeric_limits<qint64>::max() || microseconds == std::numeric_limits<qint64>::min())
+    {
+       out.append((microseconds > 0) ? "infinity" : "-infinity");
+       return;
+    }
+
+    constexpr qint64 day = Q_INT64_C(86400000000);
+    qint64 days = microseconds / day, time = microseconds % day;
+
+    if(time < 0)
+    {
+       time += day;
+       days--;
+    }
+
+    appendDate(out, qint32(days));
+    out.append('T');
+    appendTime(out, time);
+    if(utc) out.append('Z');
+}
+
+static void appendZone(QByteArray & out, qint32 west)
+{
+    out.append((west > 0) ? '-' : '+');
+    west = std::abs(west);
+
+    appendPadded(out, west / 3600, 2);
+    out.append(':');
+    appendPadded(out, west / 60 % 60, 2);
+}
+
+static void appendHex(QByteArray & out, const char * data, qint32 size)
+{
+    for(qint32 i = 0; i < size; i++)
+    {
+        const uchar c = uchar(data[i]);
+        const char pair[] = {hexDigits[c >> 4], hexDigits[c & 0x0f]};
+        out.append(pair, 2);
+    }
+}
+
+static void appendUuid(QByteArray & out, const char * data)
+{
+    static constexpr int groups[] = {4, 2, 2, 2, 6};
+
+    for(int g = 0; g < 5; g++)
+    {
+        if(g > 0) out.append('-');
+        appendHex(out, data, groups[g]);
+        data += groups[g];
+    }
+}
+
+static qint32 plainPrefix(const char * data, qint32 size, char delimiter, bool json)
+{
+    qint32 i = 0;
+
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"'), special = _mm_set1_epi8(json ? '\\' : delimiter);
+    const __m128i control = _mm_set1_epi8(0x1f), lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+
+    for(; i + 16 <= size; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, special));
+
+        if(json) m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+        else m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+
+        if(_mm_movemask_epi8(m) != 0) break;
+    }
+#endif
+
+    for(; i < size; i++)
+    {
+        const uchar c = uchar(data[i]);
+        if(c == '"') return i;
+        if(json ? (c == '\\' || c < 0x20) : (c == uchar(delimiter) || c == '\n' || c == '\r')) return i;
+    }
+
+    return size;
+}
+
+static void appendText(QByteArray & out, const char * data, qint32 size, char delimiter, bool json)
+{
+    if(!json)
+    {
+       if(size > 0 && plainPrefix(data, size, delimiter, false) == size)
+       {
+          out.append(data, size);
+          return;
+       }
+
+       out.append('"');
+
+       for(qint32 i = 0; i < size;)
+       {
+           const char * quote = static_cast<const char *>(std::memchr(data + i, '"', size - i));
+           const qint32 end = (quote == nullptr) ? size : qint32(quote - data) + 1;
+
+           out.append(data + i, end - i);
+           if(quote != nullptr) out.append('"');
+           i = end;
+       }
+
+       out.append('"');
+       return;
+    }
+
+    out.append('"');
+
+    for(qint32 i = 0; i < size;)
+    {
+        const qint32 run = plainPrefix(data + i, size - i, 0, true);
+        out.append(data + i, run);
+        i += run;
+
+        if(i == size) break;
+
+        const uchar c = uchar(data[i++]);
+
+        switch(c)
+        {
+                case '"': out.append("\\\"");
+                break;
+                case '\\': out.append("\\\\");
+                break;
+                case '\n': out.append("\\n");
+                break;
+                case '\r': out.append("\\r");
+                break;
+                case '\t': out.append("\\t");
+                break;
+                default:
+                {
+                  const char escape[] = {'\\', 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 0x0f]};
+                  out.append(escape, sizeof (escape));
+                }
+        }
+    }
+
+    out.append('"');
+}
+
+static QByteArray variantText(const QVariant & variant, bool * string = nullptr)
+{
+    const QJsonValue value = QJsonValue::fromVariant(variant);
+
+    if(string != nullptr) *string = value.isString();
+    if(value.isString()) return value.toString().toUtf8();
+
+    const QByteArray text = QJsonDocument(QJsonArray{value}).toJson(QJsonDocument::Compact);
+    return text.mid(1, text.size() - 2);
+}
+
+Result::Result() : _d(new Data){}
+
+const QVector<Field> & Result::fields() const
+{
+    return _d->fields;
+}
+
+int Result::rowCount() const
+{
+    return _d->size();
+}
+
+int Result::columnCount() const
+{
+    return _d->fields.size();
+}
+
+int Result::indexOf(const QString & name) const
+{
+    return _d->names.value(name, -1);
+}
+
+QVariant Result::value(int row, const QString & name) const
+{
+    return value(row, indexOf(name));
+}
+
+QVariant Result::value(int row, int column) const
+{
+    qint32 size;
+    const char * data = cell(row, column, size);
+
+    if(data == nullptr || size < 0) return QVariant();
+    return decode(column, data, size);
+}
+
+QVariant Result::decode(int column, const char * data, qint32 size) const
+{
+    constexpr auto types = GotoPointers<KindCount>(
+
+        &&_BYTEA,
+
+        {
+            {BoolKind, &&_BOOL},
+            {Int2Kind, &&_INT2},
+            {Int4Kind, &&_INT4},
+            {Int8Kind, &&_INT8},
+            {Float4Kind, &&_FLOAT4},
+            {Float8Kind, &&_FLOAT8},
+            {DateKind, &&_DATE},
+            {TimeKind, &&_TIME},
+            {TimeTzKind, &&_TIMETZ},
+            {TimestampKind, &&_TIMESTAMP},
+            {ByteaKind, &&_BYTEA},
+            {TextKind, &&_TEXT},
+            {UuidKind, &&_UUID},
+            {NumericKind, &&_NUMERIC},
+            {JsonKind, &&_JSON},
+            {ArrayKind, &&_ARRAY},
+            {CodecKind, &&_CODEC}
+        }
+    );
+
+    goto *types.pointers[_d->fields.at(column)._kind];
+
+   _BOOL:
+    return (data[0] == 0) ? false : true;
+
+   _INT2:
+    return QVariant::fromValue(qFromBigEndian<qint16>(data));
+
+   _INT4:
+    return qFromBigEndian<qint32>(data);
+
+   _INT8:
+    return qFromBigEndian<qint64>(data);
+
+   _FLOAT4:
+    return QVariant::fromValue(qFromBigEndian<float>(data));
+
+   _FLOAT8:
+    return qFromBigEndian<double>(data);
+
+   _DATE:
+    return Binary<QDate>::read(data, size);
+
+   _TIME:
+    return Binary<QTime>::read(data, size);
+
+   _TIMETZ:
+    return Binary<QDateTime>::readTz(data, size);
+
+   _TIMESTAMP:
+    return Binary<QDateTime>::read(data, size);
+
+   _BYTEA:
+    return QByteArray(data, size);
+
+   _TEXT:
+    return utf8String(data, size);
+
+   _UUID:
+    return QUuid::fromRfc4122(QByteArray(data, 16));
+
+   _NUMERIC:
+    return QVariant::fromValue(Binary<Numeric>::read(data, size));
+
+   _JSON:
+    return Binary<QJsonDocument>::read(data, size);
+
+   _ARRAY:
+    return readArray(data, size);
+
+   _CODEC:
+    return _d->fields.at(column)._codec->_decoder(data, size);
+}
+
+template<typename C> C Result::arrayCell(int row, int column) const
+{
+    qint32 size;
+    const char * data = cell(row, column, size);
+
+    if(data == nullptr || size < 0 || _d->fields.at(column).formatType() != 1) return C();
+    return readArray<C>(data, size);
+}
+
+#define ArrayAccessor(T) \
+template QVector<T> Result::arrayCell<QVector<T>>(int row, int column) const; \
+template std::vector<T> Result::arrayCell<std::vector<T>>(int row, int column) const;
+
+ArrayAccessor(bool)
+ArrayAccessor(qint16)
+ArrayAccessor(qint32)
+ArrayAccessor(qint64)
+ArrayAccessor(float)
+ArrayAccessor(double)
+ArrayAccessor(QDate)
+ArrayAccessor(QTime)
+ArrayAccessor(QDateTime)
+ArrayAccessor(QByteArray)
+ArrayAccessor(QString)
+ArrayAccessor(QUuid)
+ArrayAccessor(Numeric)
+
+template<typename T> QVector<T> Result::columnValues(int column) const
+{
+    QVector<T> values;
+    if(column < 0 || column >= _d->fields.size()) return values;
+
+    const auto reader = Column<T>::reader(binaryType(_d->fields.at(column)));
+    if(reader == nullptr) return values;
+
+    values.reserve(rowCount());
+
+    for(int row = 0; row < rowCount(); row++)
+    {
+        qint32 size;
+        const char * data = cell(row, column, size);
+        values.append((size < 0) ? T() : reader(data, size));
+    }
+
+    return values;
+}
+
+template<typename T> QVector<T> Result::parallelColumnValues(int column, QThreadPool * pool) const
+{
+    QVector<T> values;
+    if(column < 0 || column >= _d->fields.size()) return values;
+
+    const auto reader = Column<T>::reader(binaryType(_d->fields.at(column)));
+    if(reader == nullptr) return values;
+
+    values.resize(rowCount());
+    T * out = values.data();
+
+    parallelRanges([this, reader, column, out](int first, int last)
+    {
+        for(int row = first; row < last; row++)
+        {
+            qint32 size;
+            const char * data = cell(row, column, size);
+            out[row] = (size < 0) ? T() : reader(data, size);
+        }
+    }, pool);
+
+    return values;
+}
+
+#define ColumnAccessor(T) \
+template QVector<T> Result::columnValues<T>(int column) const; \
+template QVector<T> Result::parallelColumnValues<T>(int column, QThreadPool * pool) const;
+
+ColumnAccessor(bool)
+ColumnAccessor(qint16)
+ColumnAccessor(qint32)
+ColumnAccessor(qint64)
+ColumnAccessor(float)
+ColumnAccessor(double)
+ColumnAccessor(QDate)
+ColumnAccessor(QTime)
+ColumnAccessor(QDateTime)
+ColumnAccessor(QByteArray)
+ColumnAccessor(QString)
+ColumnAccessor(QUuid)
+ColumnAccessor(Numeric)
+ColumnAccessor(QJsonDocument)
+
+template<typename T> Result::Reader<T> Result::reader(int column, QString & error) const
+{
+    if(column < 0 || column >= _d->fields.size())
+    {
+       if(error.isEmpty()) error = Query::tr("Column not found: ") + QString::number(column);
+       return nullptr;
+    }
+
+    auto reader = Column<T>::reader(binaryType(_d->fields.at(column)));
+    if(reader == nullptr && error.isEmpty()) error = Query::tr("Column type mismatch: ") + _d->fields.at(column)._name;
+
+    return reader;
+}
+
+#define ReaderAccessor(T) \
+template Result::Reader<T> Result::reader<T>(int column, QString & error) const;
+
+ReaderAccessor(bool)
+ReaderAccessor(qint16)
+ReaderAccessor(qint32)
+ReaderAccessor(qint64)
+ReaderAccessor(float)
+ReaderAccessor(double)
+ReaderAccessor(QDate)
+ReaderAccessor(QTime)
+ReaderAccessor(QDateTime)
+ReaderAccessor(QByteArray)
+ReaderAccessor(QString)
+ReaderAccessor(QUuid)
+ReaderAccessor(Numeric)
+ReaderAccessor(QJsonDocument)
+
+QJsonDocument Result::jsonDocument(int row, int column) const
+{
+    qint32 size;
+    const char * data = cell(row, column, size);
+
+    if(data == nullptr || size < 0 || !Binary<QJsonDocument>::accepts(binaryType(_d->fields.at(column)))) return QJsonDocument();
+    return Binary<QJsonDocument>::read(data, size);
+}
+
+#if QT_VERSION >= 0x060000
+QByteArrayView Result::json(int row, int column) const
+{
+    qint32 size;
+    const char * data = cell(row, column, size);
+
+    if(data == nullptr || size < 0 || !Binary<QJsonDocument>::accepts(binaryType(_d->fields.at(column)))) return QByteArrayView();
+    if(size > 0 && data[0] == JsonbVersion) return QByteArrayView(data + 1, size - 1);
+    return QByteArrayView(data, size);
+}
+
+QUtf8StringView Result::jsonText(int row, int column) const
+{
+    const QByteArrayView view = json(row, column);
+    return QUtf8StringView(view.data(), view.size());
+}
+#else
+QByteArray Result::json(int row, int column) const
+{
+    qint32 size;
+    const char * data = cell(row, column, size);
+
+    if(data == nullptr || size < 0 || !Binary<QJsonDocument>::accepts(binaryType(_d->fields.at(column)))) return QByteArray();
+    return jsonText(data, size);
+}
+#endif
+
+#if QT_VERSION >= 0x060000
+QByteArrayView Result::bytes(int row, int column) const
+{
+    qint32 size;
+    const char * data = cell(row, column, size);
+
+    if(data == nullptr || size < 0) return QByteArrayView();
+    return QByteArrayView(data, size);
+}
+
+QUtf8StringView Result::text(int row, int column) const
+{
+    qint32 size;
+    const char * data = cell(row, column, size);
+
+    if(data == nullptr || size < 0 || _d->fields.at(column)._kind != TextKind) return QUtf8StringView();
+    return QUtf8StringView(data, size);
+}
+#else
+QByteArray Result::bytes(int row, int column) const
+{
+    qint32 size;
+    const char * data = cell(row, column, size);
+
+    if(data == nullptr || size < 0) return QByteArray();
+    return QByteArray::fromRawData(data, size);
+}
+#endif
+
+qint64 Result::microseconds(int row, int column) const
+{
+    qint32 size;
+    const char * data = cell(row, column, size);
+
+    if(data == nullptr || size < qint32(sizeof (qint64))) return 0;
+
+    auto reader = Column<qint64>::microseconds(binaryType(_d->fields.at(column)));
+    return (reader == nullptr) ? 0 : reader(data, size);
+}
+
+QString Result::string(int row, int column) const
+{
+    qint32 size;
+    const char * data = cell(row, column, size);
+
+    if(data == nullptr || size < 0 || _d->fields.at(column)._kind != TextKind) return QString();
+    return utf8String(data, size);
+}
+
+QString Result::commandTag() const
+{
+    return QString::fromLatin1(_d->tag);
+}
+
+qint64 Result::affectedRows() const
+{
+    bool ok = false;
+    const qint64 rows = _d->tag.mid(_d->tag.lastIndexOf(' ') + 1).toLongLong(&ok);
+
+    return ok ? rows : -1;
+}
+
+qint64 Result::writeCsv(QIODevice * device, int from, char delimiter) const
+{
+    return writeText(device, from, delimiter, false);
+}
+
+qint64 Result::writeJsonLines(QIODevice * device, int from) const
+{
+    return writeText(device, from, 0, true);
+}
+
+qint64 Result::writeText(QIODevice * device, int from, char delimiter, bool json) const
+{
+    constexpr auto types = GotoPointers<KindCount>(
+
+      &&_default,
+
+      {
+        {BoolKind, &&_BOOL},
+        {Int2Kind, &&_INT2},
+        {Int4Kind, &&_INT4},
+        {Int8Kind, &&_INT8},
+        {Float4Kind, &&_FLOAT4},
+        {Float8Kind, &&_FLOAT8},
+        {DateKind, &&_DATE},
+        {TimeKind, &&_TIME},
+        {TimeTzKind, &&_TIMETZ},
+        {TimestampKind, &&_TIMESTAMP},
+        {ByteaKind, &&_BYTEA},
+        {TextKind, &&_TEXT},
+        {UuidKind, &&_UUID},
+        {NumericKind, &&_NUMERIC},
+        {JsonKind, &&_JSON}
+      }
+    );
+
+    if(device == nullptr || !device->isWritable()) return -1;
+
+    const int columns = _d->fields.size();
+    QVector<QByteArray> keys;
+    QByteArray out;
+    qint64 written = 0;
+
+    out.reserve(ExportChunkSize * 2);
+
+    for(int i = 0; i < columns; i++)
+    {
+        const QByteArray name = _d->fields.at(i)._name.toUtf8();
+
+        if(json)
+        {
+           QByteArray key(1, (i == 0) ? '{' : ',');
+           appendText(key, name.constData(), name.size(), 0, true);
+           key.append(':');
+           keys.append(key);
+        }
+        else if(from <= 0)
+        {
+           if(i > 0) out.append(delimiter);
+           appendText(out, name.constData(), name.size(), delimiter, false);
+        }
+    }
+
+    if(!json && from <= 0 && columns > 0) out.append('\n');
+
+    QVarLengthArray<const char *, 32> data(columns);
+    QVarLengthArray<qint32, 32> size(columns);
+
+    for(int row = qMax(0, from); row < rowCount(); row++)
+    {
+        cells(row, data.data(), size.data());
+
+        for(int i = 0; i < columns; i++)
+        {
+            const char * cell = data[i];
+            const qint32 length = size[i];
+
+            if(json) out.append(keys[i]);
+            else if(i > 0) out.append(delimiter);
+
+            if(length < 0)
+            {
+               if(json) out.append("null");
+               continue;
+            }
+
+            goto *types.pointers[_d->fields.at(i)._kind];
+
+            _BOOL:
+             out.append((cell[0] == 0) ? "false" : "true");
+             continue;
+
+            _INT2:
+             appendInteger(out, qFromBigEndian<qint16>(cell));
+             continue;
+
+            _INT4:
+             appendInteger(out, qFromBigEndian<qint32>(cell));
+             continue;
+
+            _INT8:
+             appendInteger(out, qFromBigEndian<qint64>(cell));
+             continue;
+
+            _FLOAT4:
+             appendFloat(out, qFromBigEndian<float>(cell), true, json);
+             continue;
+
+            _FLOAT8:
+             appendFloat(out, qFromBigEndian<double>(cell), false, json);
+             continue;
+
+            _DATE:
+             if(json) out.append('"');
+             appendDate(out, qFromBigEndian<qint32>(cell));
+             goto _quoted;
+
+            _TIME:
+             if(json) out.append('"');
+             appendTime(out, qFromBigEndian<qint64>(cell));
+             goto _quoted;
+
+            _TIMETZ:
+             if(json) out.append('"');
+             appendTime(out, qFromBigEndian<qint64>(cell));
+             appendZone(out, qFromBigEndian<qint32>(cell + sizeof (qint64)));
+             goto _quoted;
+
+            _TIMESTAMP:
+             if(json) out.append('"');
+             appendTimestamp(out, qFromBigEndian<qint64>(cell), _d->fields.at(i)._typeOID == _TIMESTAMPTZOID);
+             goto _quoted;
+
+            _BYTEA:
+             out.append(json ? "\"\\\\x" : "\\x");
+             appendHex(out, cell, length);
+             goto _quoted;
+
+            _UUID:
+             if(json) out.append('"');
+             appendUuid(out, cell);
+             goto _quoted;
+
+            _TEXT:
+             appendText(out, cell, length, delimiter, json);
+             continue;
+
+            _NUMERIC:
+             {
+               const qsizetype start = out.size();
+               appendNumeric(out, cell, length);
+
+               if(json && start < out.size() && (out[start] == 'N' || out[start] == 'I' || (out[start] == '-' && out[start + 1] == 'I')))
+               {
+                  out.insert(start, '"');
+                  out.append('"');
+               }
+             }
+             continue;
+
+            _JSON:
+             {
+               const bool binary = (length > 0 && cell[0] == JsonbVersion);
+
+               if(json) out.append(cell + binary, length - binary);
+               else appendText(out, cell + binary, length - binary, delimiter, false);
+             }
+             continue;
+
+            _default:
+             {
+               bool string;
+               const QByteArray text = variantText(value(row, i), &string);
+
+               if(json && !string) out.append(text);
+               else appendText(out, text.constData(), text.size(), delimiter, json);
+             }
+             continue;
+
+            _quoted:
+             if(json) out.append('"');
+        }
+
+        if(json) out.append((columns == 0) ? "{}\n" : "}\n");
+        else out.append('\n');
+
+        if(out.size() >= ExportChunkSize)
+        {
+           if(device->write(out) != out.size()) return -1;
+           written += out.size();
+           out.truncate(0);
+        }
+    }
+
+    if(!out.isEmpty())
+    {
+       if(device->write(out) != out.size()) return -1;
+       written += out.size();
+    }
+
+    return written;
+}
+
+const char * Result::cell(int row, int column, qint32 & size) const
+{
+    size = -1;
+    if(row < 0 || row >= rowCount() || column < 0 || column >= _d->fields.size()) return nullptr;
+
+    const char * data = rowData(row);
+    if(data == nullptr) return nullptr;
+
+    for(int i = 0; i < column; i++)
+    {
+        qint32 sz = qFromBigEndian<qint32>(data);
+        data += sizeof (qint32);
+        if(sz > 0) data += sz;
+    }
+
+    size = qFromBigEndian<qint32>(data);
+    return data + sizeof (qint32);
+}
+
+void Result::cells(int row, const char ** data, qint32 * size) const
+{
+    const char * pos = rowData(row);
+
+    for(int i = 0; i < _d->fields.size(); i++)
+    {
+        if(pos == nullptr)
+        {
+           size[i] = -1;
+           continue;
+        }
+
+        size[i] = qFromBigEndian<qint32>(pos);
+        pos += sizeof (qint32);
+        data[i] = pos;
+        if(size[i] > 0) pos += size[i];
+    }
+}
+
+QVector<QVariantList> Result::parallelRows(QThreadPool * pool) const
+{
+    QVector<QVariantList> values(rowCount());
+    QVariantList * out = values.data();
+    const int columns = _d->fields.size();
+
+    parallelRanges([this, out, columns](int first, int last)
+    {
+        QVarLengthArray<const char *, 32> data(columns);
+        QVarLengthArray<qint32, 32> size(columns);
+
+        for(int row = first; row < last; row++)
+        {
+            cells(row, data.data(), size.data());
+
+            QVariantList & values = out[row];
+            values.reserve(columns);
+
+            for(int i = 0; i < columns; i++) values.append((size[i] < 0) ? QVariant() : decode(i, data[i], size[i]));
+        }
+    }, pool);
+
+    return values;
+}
+
+void Result::parallelRanges(const RangeHandler & handler, QThreadPool * pool) const
+{
+    struct State
+    {
+        std::atomic<int> next{0};
+        QSemaphore done;
+    };
+
+    const int rows = rowCount();
+    if(rows == 0) return;
+
+    if(pool == nullptr) pool = QThreadPool::globalInstance();
+
+    const int threads = qMax(1, pool->maxThreadCount());
+    const int chunk = qMax(ParallelMinimumRows, (rows + threads * 4 - 1) / (threads * 4));
+    const int ranges = (rows + chunk - 1) / chunk;
+
+    auto state = QSharedPointer<State>::create();
+
+    auto work = [state, &handler, rows, chunk, ranges]()
+    {
+        for(int i = state->next++; i < ranges; i = state->next++)
+        {
+            handler(i * chunk, qMin(rows, (i + 1) * chunk));
+            state->done.release();
+        }
+    };
+
+    for(int i = 1; i < qMin(threads, ranges); i++) pool->start(work);
+
+    work();
+    state->done.acquire(ranges);
+}
+
+QString Result::columnCountError(int columns, int members)
+{
+    return Query::tr("Column count mismatch: ") + QString::number(columns) + Query::tr(" columns for ") + QString::number(members) + Query::tr(" members");
+}
+
+const char * Result::rowData(int row) const
+{
+    return _d->row(row);
+}
+
+QVector<int> Result::columnIndexes(const QStringList & columns) const
+{
+    QVector<int> index;
+    index.reserve(columns.size());
+
+    for(const QString & name : columns) index.append(indexOf(name));
+
+    return index;
+}
+
+//Query===================================================================================================
+//========================================================================================================
+
+quint64 Query::_stmt_number = 0;
+Query::Query(Connection * db, QObject * parent) : QObject(parent), _db(db){}
+
+Query::~Query()
+{
+    if(_portal == PortalHeld && !_db.isNull()) _db->discardPortal(this);
+
+    if(!_db.isNull())
+    {
+       _db->removeQuery(this);
+       _db->account(-_memoryUsed);
+    }
+}
+
+const QString & Query::lastQuery() const
+{
+    return _lastQuery;
+}
+
+void Query::exec()
+{
+    if(_db == nullptr) return;
+    closePortal();
+
+    if(_prepare)
+    {
+        if(!_prepareFinished) return;
+
+        clearRows();
+        _db->addQuery(this);
+    }
+    else if(!_lastQuery.isEmpty())
+    {
+        if(_script) resetResults(); else clearRows();
+        _db->addQuery(this);
+    }
+}
+
+void Query::exec(const QString & query)
+{
+    if(_db == nullptr) return;
+    closePortal();
+    _prepare = false;
+    _script = false;
+    preparation(query);
+}
+
+void Query::execScript(const QString & script)
+{
+    if(_db == nullptr) return;
+    closePortal();
+    _prepare = false;
+    _script = true;
+    resetResults();
+    preparation(script);
+}
+
+void Query::prepare(const QString & query)
+{
+    if(_db == nullptr) return;
+    closePortal();
+    _prepare = true;
+    _script = false;
+    _stmt_number++;
+    _stmtName = "stmt_" + QByteArray::number(_stmt_number);
+    preparation(query);
+}
+
+const QVector<QVariant> & Query::bindValues() const
+{
+    return _bindValues;
+}
+
+void Query::bindValue(int index, const std::variant<qint16, qint32, QVariant> & value)
+{
+    if(!bindIndex(index)) return;
+
+    _bindValues[index] = QVariant::fromStdVariant(value);
+    _parameterState[index] = ParameterVariant;
+}
+
+void Query::bindEncoded(int index, const QByteArray & data)
+{
+    if(!bindIndex(index)) return;
+
+    _parameterData[index] = ownedBytes(data);
+    _bindValues[index] = QVariant();
+    _parameterState[index] = ParameterEncoded;
+}
+
+bool Query::unbind(int index, const QString & message)
+{
+    _parameterData[index].truncate(0);
+    _bindValues[index] = QVariant();
+    _parameterState[index] = ParameterUnbound;
+
+    Message e;
+    e._message = message;
+    emit error(e);
+    return false;
+}
+
+template<typename T> bool Query::bindTyped(int index, const T & value)
+{
+    if(!bindIndex(index)) return false;
+
+    if(_parameterCodecs[index])
+    {
+       bindValue(index, QVariant::fromValue(value));
+       return true;
+    }
+
+    if constexpr(std::is_same<T, Numeric>::value)
+    {
+       if(value.isNull()) return unbind(index, tr("A null Numeric cannot be bound to parameter: ") + QString::number(index + 1));
+    }
+
+    const auto writer = Parameter<T>::writer(_preparedParametrs[index]);
+    if(writer == nullptr) return unbind(index, tr("The binding does not support the type OID: ") + QString::number(_preparedParametrs[index]));
+
+    QByteArray & data = _parameterData[index];
+    data.truncate(0);
+
+    if constexpr(std::is_same<T, QByteArray>::value)
+    {
+       if(value.size() >= LargeParameterSize && _preparedParametrs[index] != _JSONBOID) data = ownedBytes(value);
+       else writer(data, value);
+    }
+    else writer(data, value);
+
+    _bindValues[index] = QVariant();
+    _parameterState[index] = ParameterEncoded;
+    return true;
+}
+
+template bool Query::bindTyped<bool>(int index, const bool & value);
+template bool Query::bindTyped<qint16>(int index, const qint16 & value);
+template bool Query::bindTyped<qint32>(int index, const qint32 & value);
+template bool Query::bindTyped<qint64>(int index, const qint64 & value);
+template bool Query::bindTyped<float>(int index, const float & value);
+template bool Query::bindTyped<double>(int index, const double & value);
+template bool Query::bindTyped<QDate>(int index, const QDate & value);
+template bool Query::bindTyped<QTime>(int index, const QTime & value);
+template bool Query::bindTyped<QDateTime>(int index, const QDateTime & value);
+template bool Query::bindTyped<QByteArray>(int index, const QByteArray & value);
+template bool Query::bindTyped<QString>(int index, const QString & value);
+template bool Query::bindTyped<QUuid>(int index, const QUuid & value);
+template bool Query::bindTyped<Numeric>(int index, const Numeric & value);
+template bool Query::bindTyped<QJsonDocument>(int index, const QJsonDocument & value);
+
+bool Query::bindIndex(int index)
+{
+    if(_db == nullptr || !_prepareFinished) return false;
+    if(index >= 0 && index < _preparedParametrs.size()) return true;
+
+    Message e;
+    e._message = tr("Incorrect parameter index: ") + QString::number(index);
+    emit error(e);
+    return false;
+}
+
+const QVector<Field> & Query::fields() const
+{
+    return _result.fields();
+}
+
+void Query::setStream(int column, QIODevice * device)
+{
+    QPointer<QIODevice> target(device);
+
+    setStream(column, [target](int, const char * data, qint64 size)
+    {
+        if(!target.isNull() && size > 0) target->write(data, size);
+    });
+}
+
+void Query::setStream(int column, const StreamHandler & handler)
+{
+    if(handler) _streams.insert(column, handler);
+    else _streams.remove(column);
+}
+
+void Query::clearStreams()
+{
+    _streams.clear();
+}
+
+int Query::rowCount() const
+{
+    return _result.rowCount();
+}
+
+int Query::columnCount() const
+{
+    return _result.columnCount();
+}
+
+int Query::indexOf(const QString & name) const
+{
+    return _result.indexOf(name);
+}
+
+QVariant Query::value(int row, int column) const
+{
+    return _result.value(row, column);
+}
+
+QVariant Query::value(int row, const QString & name) const
+{
+    return _result.value(row, name);
+}
+
+QJsonDocument Query::jsonDocument(int row, int column) const
+{
+    return _result.jsonDocument(row, column);
+}
+
+#if QT_VERSION >= 0x060000
+QByteArrayView Query::json(int row, int column) const
+{
+    return _result.json(row, column);
+}
+
+QUtf8StringView Query::jsonText(int row, int column) const
+{
+    return _result.jsonText(row, column);
+}
+#else
+QByteArray Query::json(int row, int column) const
+{
+    return _result.json(row, column);
+}
+#endif
+
+#if QT_VERSION >= 0x060000
+QByteArrayView Query::bytes(int row, int column) const
+{
+    return _result.bytes(row, column);
+}
+
+QUtf8StringView Query::text(int row, int column) const
+{
+    return _result.text(row, column);
+}
+#else
+QByteArray Query::bytes(int row, int column) const
+{
+    return _result.bytes(row, column);
+}
+#endif
+
+QVector<QVariantList> Query::parallelRows(QThreadPool * pool) const
+{
+    return _result.parallelRows(pool);
+}
+
+void Query::parallelRanges(const Result::RangeHandler & handler, QThreadPool * pool) const
+{
+    _result.parallelRanges(handler, pool);
+}
+
+qint64 Query::writeCsv(QIODevice * device, int from, char delimiter) const
+{
+    return _result.writeCsv(device, from, delimiter);
+}
+
+qint64 Query::writeJsonLines(QIODevice * device, int from) const
+{
+    return _result.writeJsonLines(device, from);
+}
+
+qint64 Query::microseconds(int row, int column) const
+{
+    return _result.microseconds(row, column);
+}
+
+QString Query::string(int row, int column) const
+{
+    return _result.string(row, column);
+}
+
+Result Query::takeResult()
+{
+    Result result = _result;
+    result._d->finish();
+    clearRows();
+
+    return result;
+}
+
+QVector<Result> Query::results()
+{
+    if(_script) return _results;
+
+    _result._d->finish();
+    _resultShared = true;
+
+    return {_result};
+}
+
+QString Query::commandTag() const
+{
+    return _result.commandTag();
+}
+
+qint64 Query::affectedRows() const
+{
+    return _result.affectedRows();
+}
+
+void Query::report(const QString & message) const
+{
+    Message e;
+    e._message = message;
+    emit const_cast<Query *>(this)->error(e);
+}
+
+int Query::fetchSize() const
+{
+    return _fetchSize;
+}
+
+void Query::setFetchSize(int rows)
+{
+    _fetchSize = qMax(0, rows);
+}
+
+bool Query::canFetchMore() const
+{
+    return _portal == PortalHeld && !_db.isNull();
+}
+
+void Query::fetchMore()
+{
+    if(canFetchMore()) _db->fetchPortal(this);
+}
+
+void Query::closePortal()
+{
+    if(canFetchMore()) _db->closePortal(this);
+}
+
+qint64 Query::spillThreshold() const
+{
+    return _spillThreshold;
+}
+
+void Query::setSpillThreshold(qint64 bytes)
+{
+    _spillThreshold = bytes;
+}
+
+qint64 Query::memoryUsage() const
+{
+    return _memoryUsed;
+}
+
+qint64 Query::memoryPeak() const
+{
+    return _memoryPeak;
+}
+
+void Query::setMemoryLimits(qint64 soft, qint64 hard)
+{
+    _memorySoft = soft;
+    _memoryHard = hard;
+    _memoryWarned = false;
+}
+
+bool Query::exceeds(qint64 size) const
+{
+    if(_memoryHard > 0 && _memoryUsed + size > _memoryHard) return true;
+    return !_db.isNull() && _db->_memoryHard > 0 && _db->_memoryUsed + size > _db->_memoryHard;
+}
+
+void Query::abort(const QString & message)
+{
+    if(_aborted) return;
+
+    _aborted = true;
+    clearRows();
+
+    Message e;
+    e._message = message;
+    emit error(e);
+
+    if(!_db.isNull()) _db->cancel();
+}
+
+void Query::clearRows()
+{
+    QSharedPointer<Result::Data> data(new Result::Data);
+    data->fields = _result._d->fields;
+    data->names = _result._d->names;
+    _result._d = data;
+    _resultShared = false;
+
+    if(!_db.isNull()) _db->account(-_memoryUsed);
+    _memoryUsed = 0;
+    _memoryWarned = false;
+}
+
+void Query::clear()
+{
+    clearRows();
+
+    _result._d->fields.clear();
+    _result._d->names.clear();
+    _preparedParametrs.clear();
+    _parameterCodecs.clear();
+    _bindValues.clear();
+    _parameterData.clear();
+    _parameterState.clear();
+    _parameterOffsets.clear();
+    _bindTemplate.clear();
+}
+
+void Query::resetResults()
+{
+    _results.clear();
+    _result._d.reset(new Result::Data);
+    _statementDone = false;
+    _resultShared = false;
+
+    if(!_db.isNull()) _db->account(-_memoryUsed);
+    _memoryUsed = 0;
+    _memoryWarned = false;
+}
+
+void Query::detachShared()
+{
+    if(_resultShared) clearRows();
+}
+
+void Query::startStatement()
+{
+    if(!_statementDone) return;
+
+    _result._d.reset(new Result::Data);
+    _statementDone = false;
+}
+
+void Query::preparation(const QString & query)
+{
+    clear();
+
+    _lastQuery = query;
+    _prepareFinished = false;
+    _db->addQuery(this);
+}
+
+void Query::addPreparedParametr(quint32 oid)
+{
+    _preparedParametrs.append(oid);
+
+    auto codec = _db->_codecs.value(oid);
+    _parameterCodecs.append((codec.isNull() || !codec->_encoder) ? QSharedPointer<const Codec>() : codec);
+
+    _bindValues.append(QVariant());
+    _parameterData.append(QByteArray());
+    _parameterState.append(ParameterUnbound);
+}
+
+void Query::addDataRow(const char * data, quint32 size)
+{
+    if(_aborted) return;
+    detachShared();
+
+    Result::Data & result = *_result._d;
+
+    if(result.spill == nullptr && _spillThreshold > 0 && _memoryUsed + size > _spillThreshold)
+    {
+       result.spill = new QTemporaryFile;
+
+       if(!result.spill->open())
+       {
+          Message e;
+          e._message = tr("Unable to create a spill file: ") + result.spill->errorString();
+          emit error(e);
+
+          delete result.spill;
+          result.spill = nullptr;
+          _spillThreshold = 0;
+       }
+    }
+
+    if(result.spill != nullptr)
+    {
+       const qint64 pos = result.spill->pos();
+
+       if(result.spill->write(data, size) != qint64(size))
+       {
+          abort(tr("Unable to write the spill file: ") + result.spill->errorString());
+          return;
+       }
+
+       result.spillRows.append(pos);
+       return;
+    }
+
+    if(exceeds(size))
+    {
+       abort(tr("Memory limit exceeded after ") + QString::number(rowCount()) + tr(" rows"));
+       return;
+    }
+
+    char * row = new char[size];
+    std::memcpy(row, data, size);
+    result.rows.append(row);
+
+    _memoryUsed += size;
+    _memoryPeak = qMax(_memoryPeak, _memoryUsed);
+    if(!_db.isNull()) _db->account(size);
+
+    if(_memorySoft > 0 && _memoryUsed >= _memorySoft && !_memoryWarned)
+    {
+       _memoryWarned = true;
+       emit memoryWarning(_memoryUsed);
+    }
+}
+
+QDebug operator << (QDebug debug, const Query & query)
+{
+    QDebugStateSaver saver(debug);
+
+    debug.nospace() << "Query(Query: " << query._lastQuery << ",\n";
+    debug.nospace() << "      Prepare: " << query._prepare << ",\n";
+    debug.nospace() << "      Prepare finished: " << query._prepareFinished << ",\n";
+    debug.nospace() << "      Statement name: " << query._stmtName << ",\n";
+    debug.nospace() << "      Fields count: " << query.columnCount() << ",\n";
+    debug.nospace() << "      Prepared parametrs OID: ";
+
+    bool first = false;
+
+    for(const auto & v : query._preparedParametrs)
+    {
+        if(!first)
+        {
+           debug.nospace() << v;
+           first = true;
+        }
+        else
+        {
+            debug.nospace() << ", " << v;
+        }
+    }
+
+    debug.nospace() << '\n';
+    debug.nospace() << "      Number of binding values: " << query._bindValues.count() << ")";
+
+    return debug;
+}
+
+//QueryModel==============================================================================================
+//========================================================================================================
+
+QueryModel::QueryModel(Query * query, QObject * parent) : QAbstractTableModel(parent), _query(query)
+{
+    connect(query, &Query::executeFinished, this, &QueryModel::executeFinished);
+    connect(query, &Query::error, this, [this](){ _fetching = false; });
+}
+
+Query * QueryModel::query() const
+{
+    return _query;
+}
+
+int QueryModel::rowCount(const QModelIndex & parent) const
+{
+    return parent.isValid() ? 0 : _rows;
+}
+
+int QueryModel::columnCount(const QModelIndex & parent) const
+{
+    return parent.isValid() ? 0 : _columns;
+}
+
+QVariant QueryModel::data(const QModelIndex & index, int role) const
+{
+    if(_query.isNull() || !index.isValid() || (role != Qt::DisplayRole && role != Qt::EditRole)) return QVariant();
+    return _query->value(index.row(), index.column());
+}
+
+QVariant QueryModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(_query.isNull() || role != Qt::DisplayRole) return QVariant();
+    if(orientation == Qt::Vertical) return section + 1;
+
+    if(section < 0 || section >= _query->columnCount()) return QVariant();
+    return _query->fields()[section].name();
+}
+
+bool QueryModel::canFetchMore(const QModelIndex & parent) const
+{
+    return !parent.isValid() && !_fetching && !_query.isNull() && _query->canFetchMore();
+}
+
+void QueryModel::fetchMore(const QModelIndex & parent)
+{
+    if(!canFetchMore(parent)) return;
+
+    _fetching = true;
+    _query->fetchMore();
+}
+
+void QueryModel::executeFinished()
+{
+    _fetching = false;
+
+    const int rows = _query->rowCount(), columns = _query->columnCount();
+
+    if(columns != _columns || rows < _rows)
+    {
+       beginResetModel();
+       _rows = rows;
+       _columns = columns;
+       endResetModel();
+    }
+    else if(rows > _rows)
+    {
+       beginInsertRows(QModelIndex(), _rows, rows - 1);
+       _rows = rows;
+       endInsertRows();
+    }
+}
+
+//ArrowWriter=============================================================================================
+//========================================================================================================
+
+#define ArrowContinuation 0xFFFFFFFF
+#define ArrowMetadataV5 4
+#define ArrowSchemaHeader 1
+#define ArrowRecordBatchHeader 3
+#define ArrowMicrosecond 2
+#define ArrowUnixEpochDays 10957
+
+enum ArrowLayout : quint8
+{
+    ArrowVariant,
+    ArrowText,
+    ArrowJson,
+    ArrowNumeric,
+    ArrowTimeTz,
+    ArrowBinary,
+    ArrowBool,
+    ArrowInt16,
+    ArrowInt32,
+    ArrowInt64,
+    ArrowFloat,
+    ArrowDouble,
+    ArrowDate,
+    ArrowTime,
+    ArrowTimestamp,
+    ArrowUuid,
+    ArrowLayoutCount
+};
+
+enum ArrowType : quint8
+{
+    ArrowInt = 2,
+    ArrowFloatingPoint = 3,
+    ArrowBinaryType = 4,
+    ArrowUtf8 = 5,
+    ArrowBoolType = 6,
+    ArrowDateType = 8,
+    ArrowTimeType = 9,
+    ArrowTimestampType = 10,
+    ArrowFixedSizeBinary = 15
+};
+
+class FlatBuilder
+{
+public:
+    using Child = std::function<quint32(FlatBuilder &)>;
+
+    struct Slot
+    {
+        quint8 size = 0;
+        quint64 value = 0;
+        Child child;
+    };
+
+    static Slot scalar(quint8 size, quint64 value)
+    {
+        Slot slot;
+        slot.size = size;
+        slot.value = value;
+        return slot;
+    }
+
+    static Slot offset(const Child & child)
+    {
+        Slot slot;
+        slot.size = sizeof (quint32);
+        slot.child = child;
+        return slot;
+    }
+
+    QByteArray finish(const Child & root)
+    {
+        _data.truncate(0);
+        put(0, sizeof (quint32));
+        patch(0, root(*this));
+        align(8);
+        return _data;
+    }
+
+    quint32 table(const QVector<Slot> & entries)
+    {
+        align(sizeof (quint16));
+
+        const int vtable = _data.size(), count = entries.size();
+        _data.append((2 + count) * int(sizeof (quint16)), 0);
+
+        align(sizeof (quint32));
+        const int start = _data.size();
+        put(quint32(start - vtable), sizeof (qint32));
+
+        QVarLengthArray<int, 8> positions(count);
+
+        for(int i = 0; i < count; i++)
+        {
+            positions[i] = 0;
+            if(entries[i].size == 0) continue;
+
+            align(entries[i].size);
+            positions[i] = _data.size();
+            put(entries[i].value, entries[i].size);
+        }
+
+        patch16(vtable, (2 + count) * sizeof (quint16));
+        patch16(vtable + sizeof (quint16), _data.size() - start);
+
+        for(int i = 0; i < count; i++) patch16(vtable + (2 + i) * sizeof (quint16), (positions[i] == 0) ? 0 : positions[i] - start);
+
+        for(int i = 0; i < count; i++)
+        {
+            if(entries[i].child) patch(positions[i], entries[i].child(*this) - positions[i]);
+        }
+
+        return start;
+    }
+
+    quint32 string(const QByteArray & text)
+    {
+        align(sizeof (quint32));
+        const int start = _data.size();
+
+        put(text.size(), sizeof (quint32));
+        _data.append(text);
+        _data.append(char(0));
+
+        return start;
+    }
+
+    quint32 tables(const QVector<Child> & items)
+    {
+        align(sizeof (quint32));
+        const int start = _data.size();
+
+        put(items.size(), sizeof (quint32));
+        _data.append(items.size() * int(sizeof (quint32)), 0);
+
+        for(int i = 0; i < items.size(); i++)
+        {
+            const int at = start + (1 + i) * sizeof (quint32);
+            patch(at, items[i](*this) - at);
+        }
+
+        return start;
+    }
+
+    quint32 structs(const QByteArray & raw, int count)
+    {
+        while((_data.size() + sizeof (quint32)) % 8 != 0) _data.append(char(0));
+        const int start = _data.size();
+
+        put(count, sizeof (quint32));
+        _data.append(raw);
+
+        return start;
+    }
+
+    static void append(QByteArray & out, quint64 value, int size)
+    {
+        value = qToLittleEndian(value);
+        out.append(reinterpret_cast<const char *>(&value), size);
+    }
+
+private:
+    QByteArray _data;
+
+    void align(int n) { while(_data.size() % n != 0) _data.append(char(0)); }
+    void put(quint64 value, int size) { append(_data, value, size); }
+
+    void patch(int at, quint32 value)
+    {
+        value = qToLittleEndian(value);
+        std::memcpy(_data.data() + at, &value, sizeof (quint32));
+    }
+
+    void patch16(int at, quint16 value)
+    {
+        value = qToLittleEndian(value);
+        std::memcpy(_data.data() + at, &value, sizeof (quint16));
+    }
+};
+
+static quint8 arrowLayout(const Field & field)
+{
+    constexpr auto layouts = VariantValues<quint8, KindCount>(
+    {
+       {{BoolKind}, ArrowBool},
+       {{Int2Kind}, ArrowInt16},
+       {{Int4Kind}, ArrowInt32},
+       {{Int8Kind}, ArrowInt64},
+       {{Float4Kind}, ArrowFloat},
+       {{Float8Kind}, ArrowDouble},
+       {{DateKind}, ArrowDate},
+       {{TimeKind}, ArrowTime},
+       {{TimeTzKind}, ArrowTimeTz},
+       {{TimestampKind}, ArrowTimestamp},
+       {{ByteaKind}, ArrowBinary},
+       {{TextKind}, ArrowText},
+       {{UuidKind}, ArrowUuid},
+       {{NumericKind}, ArrowNumeric},
+       {{JsonKind}, ArrowJson}
+    });
+
+    return layouts.values[(field.formatType() == 1) ? kindOf(field.typeOID()) : TextKind];
+}
+
+static int arrowWidth(quint8 layout)
+{
+    constexpr auto widths = VariantValues<qint8, ArrowLayoutCount>(
+    {
+       {{ArrowInt16}, 2},
+       {{ArrowInt32, ArrowFloat, ArrowDate}, 4},
+       {{ArrowInt64, ArrowDouble, ArrowTime, ArrowTimestamp}, 8},
+       {{ArrowUuid}, 16}
+    });
+
+    return widths.values[layout];
+}
+
+static quint32 arrowField(FlatBuilder & flat, const Field & field)
+{
+    const quint8 layout = arrowLayout(field);
+    quint8 type = ArrowUtf8;
+    QVector<FlatBuilder::Slot> entries;
+
+    switch(layout)
+    {
+            case ArrowBinary: type = ArrowBinaryType;
+            break;
+            case ArrowBool: type = ArrowBoolType;
+            break;
+            case ArrowInt16:
+            case ArrowInt32:
+            case ArrowInt64: type = ArrowInt;
+                entries = {FlatBuilder::scalar(sizeof (qint32), arrowWidth(layout) * 8), FlatBuilder::scalar(1, 1)};
+            break;
+            case ArrowFloat:
+            case ArrowDouble: type = ArrowFloatingPoint;
+                entries = {FlatBuilder::scalar(sizeof (qint16), (layout == ArrowFloat) ? 1 : 2)};
+            break;
+            case ArrowDate: type = ArrowDateType;
+                entries = {FlatBuilder::scalar(sizeof (qint16), 0)};
+            break;
+            case ArrowTime: type = ArrowTimeType;
+                entries = {FlatBuilder::scalar(sizeof (qint16), ArrowMicrosecond), FlatBuilder::scalar(sizeof (qint32), 64)};
+            break;
+            case ArrowTimestamp: type = ArrowTimestampType;
+                entries = {FlatBuilder::scalar(sizeof (qint16), ArrowMicrosecond)};
+                if(field.typeOID() == _TIMESTAMPTZOID) entries.append(FlatBuilder::offset([](FlatBuilder & f) { return f.string("UTC"); }));
+            break;
+            case ArrowUuid: type = ArrowFixedSizeBinary;
+                entries = {FlatBuilder::scalar(sizeof (qint32), 16)};
+            break;
+    }
+
+    const QByteArray name = field.name().toUtf8();
+
+    return flat.table({
+        FlatBuilder::offset([name](FlatBuilder & f) { return f.string(name); }),
+        FlatBuilder::scalar(1, 1),
+        FlatBuilder::scalar(1, type),
+        FlatBuilder::offset([entries](FlatBuilder & f) { return f.table(entries); }),
+        FlatBuilder::Slot(),
+        FlatBuilder::offset([](FlatBuilder & f) { return f.tables({}); })
+    });
+}
+
+static quint32 arrowSchema(FlatBuilder & flat, const QVector<Field> & fields)
+{
+    QVector<FlatBuilder::Child> items;
+    for(const Field & field : fields) items.append([field](FlatBuilder & f) { return arrowField(f, field); });
+
+    return flat.table({
+        FlatBuilder::scalar(sizeof (qint16), 0),
+        FlatBuilder::offset([items](FlatBuilder & f) { return f.tables(items); })
+    });
+}
+
+static QByteArray arrowMessage(quint8 header, const FlatBuilder::Child & child, qint64 bodyLength)
+{
+    FlatBuilder flat;
+
+    return flat.finish([&](FlatBuilder & f)
+    {
+        return f.table({
+            FlatBuilder::scalar(sizeof (qint16), ArrowMetadataV5),
+            FlatBuilder::scalar(1, header),
+            FlatBuilder::offset(child),
+            FlatBuilder::scalar(sizeof (qint64), quint64(bodyLength))
+        });
+    });
+}
+
+ArrowWriter::ArrowWriter(QIODevice * device, Format format) : _device(device), _format(format){}
+
+ArrowWriter::~ArrowWriter()
+{
+    if(_started && !_closed) close();
+}
+
+const QString & ArrowWriter::errorString() const
+{
+    return _error;
+}
+
+bool ArrowWriter::write(const Query & query, int from)
+{
+    return write(query._result, from);
+}
+
+bool ArrowWriter::write(const Result & result, int from)
+{
+    if(!start(result.fields())) return false;
+
+    const QVector<Field> & fields = result.fields();
+
+    for(int i = 0; i < fields.size(); i++)
+    {
+        if(fields[i].typeOID() != _fields[i].typeOID() || arrowLayout(fields[i]) != arrowLayout(_fields[i]))
+        {
+           _error = QObject::tr("The result does not match the Arrow schema at column: ") + fields[i].name();
+           return false;
+        }
+    }
+
+    const int count = result.rowCount() - qMax(0, from);
+    if(count <= 0) return true;
+
+    constexpr auto layouts = GotoPointers<ArrowLayoutCount>(
+
+      &&_variant,
+
+      {
+        {ArrowText, &&_text},
+        {ArrowJson, &&_json},
+        {ArrowNumeric, &&_numeric},
+        {ArrowTimeTz, &&_timetz},
+        {ArrowBinary, &&_text},
+        {ArrowBool, &&_bool},
+        {ArrowInt16, &&_int16},
+        {ArrowInt32, &&_int32},
+        {ArrowInt64, &&_int64},
+        {ArrowFloat, &&_float},
+        {ArrowDouble, &&_double},
+        {ArrowDate, &&_date},
+        {ArrowTime, &&_int64},
+        {ArrowTimestamp, &&_timestamp},
+        {ArrowUuid, &&_uuid}
+      }
+    );
+
+    struct Buffers
+    {
+        quint8 layout;
+        int width;
+        qint64 nulls;
+        QByteArray validity, values, offsets;
+    };
+
+    const int columns = fields.size();
+    const int bitmap = (count + 7) / 8;
+    QVector<Buffers> out(columns);
+
+    for(int i = 0; i < columns; i++)
+    {
+        Buffers & c = out[i];
+        c.layout = arrowLayout(fields[i]);
+        c.width = arrowWidth(c.layout);
+        c.nulls = 0;
+        c.validity = QByteArray(bitmap, 0);
+
+        if(c.layout == ArrowBool) c.values = QByteArray(bitmap, 0);
+        else if(c.width > 0) c.values = QByteArray(count * c.width, 0);
+        else
+        {
+           c.offsets = QByteArray((count + 1) * int(sizeof (qint32)), 0);
+           c.values.reserve(count * 16);
+        }
+    }
+
+    QVarLengthArray<const char *, 32> data(columns);
+    QVarLengthArray<qint32, 32> size(columns);
+
+    for(int n = 0; n < count; n++)
+    {
+        const int row = qMax(0, from) + n;
+        result.cells(row, data.data(), size.data());
+
+        for(int i = 0; i < columns; i++)
+        {
+            Buffers & c = out[i];
+            const char * cell = data[i];
+            char * slot = c.values.data() + qsizetype(n) * c.width;
+
+            if(size[i] < 0)
+            {
+               c.nulls++;
+               goto _next;
+            }
+
+            c.validity[n >> 3] = char(c.validity[n >> 3] | (1 << (n & 7)));
+            goto *layouts.pointers[c.layout];
+
+            _bool:
+             if(cell[0] != 0) c.values[n >> 3] = char(c.values[n >> 3] | (1 << (n & 7)));
+             continue;
+
+            _int16: qToLittleEndian(qFromBigEndian<qint16>(cell), slot);
+             continue;
+
+            _int32: qToLittleEndian(qFromBigEndian<qint32>(cell), slot);
+             continue;
+
+            _int64: qToLittleEndian(qFromBigEndian<qint64>(cell), slot);
+             continue;
+
+            _float: qToLittleEndian(qFromBigEndian<float>(cell), slot);
+             continue;
+
+            _double: qToLittleEndian(qFromBigEndian<double>(cell), slot);
+             continue;
+
+            _date: qToLittleEndian(qint32(qFromBigEndian<qint32>(cell) + ArrowUnixEpochDays), slot);
+             continue;
+
+            _timestamp:
+             {
+               qint64 v = qFromBigEndian<qint64>(cell);
+               if(v != std::numeric_limits<qint64>::max() && v != std::numeric_limits<qint64>::min()) v += PostgresEpochUSecs;
+               qToLittleEndian(v, slot);
+             }
+             continue;
+
+            _uuid: std::memcpy(slot, cell, 16);
+             continue;
+
+            _text: c.values.append(cell, size[i]);
+             goto _next;
+
+            _json:
+             {
+               const bool binary = (size[i] > 0 && cell[0] == JsonbVersion);
+               c.values.append(cell + binary, size[i] - binary);
+             }
+             goto _next;
+
+            _numeric: appendNumeric(c.values, cell, size[i]);
+             goto _next;
+
+            _timetz:
+             appendTime(c.values, qFromBigEndian<qint64>(cell));
+             appendZone(c.values, qFromBigEndian<qint32>(cell + sizeof (qint64)));
+             goto _next;
+
+            _variant: c.values.append(variantText(result.value(row, i)));
+
+            _next:
+             if(c.width == 0 && c.layout != ArrowBool) qToLittleEndian(qint32(c.values.size()), c.offsets.data() + (n + 1) * sizeof (qint32));
+        }
+    }
+
+    QByteArray body, nodes, buffers;
+
+    auto addBuffer = [&body, &buffers](const QByteArray & buffer)
+    {
+        FlatBuilder::append(buffers, body.size(), sizeof (qint64));
+        FlatBuilder::append(buffers, buffer.size(), sizeof (qint64));
+
+        body.append(buffer);
+        while(body.size() % 8 != 0) body.append(char(0));
+    };
+
+    for(const Buffers & c : std::as_const(out))
+    {
+        FlatBuilder::append(nodes, count, sizeof (qint64));
+        FlatBuilder::append(nodes, c.nulls, sizeof (qint64));
+
+        addBuffer(c.validity);
+        if(c.width == 0 && c.layout != ArrowBool) addBuffer(c.offsets);
+        addBuffer(c.values);
+    }
+
+    const QByteArray metadata = arrowMessage(ArrowRecordBatchHeader, [&](FlatBuilder & f)
+    {
+        return f.table({
+            FlatBuilder::scalar(sizeof (qint64), count),
+            FlatBuilder::offset([&](FlatBuilder & g) { return g.structs(nodes, columns); }),
+            FlatBuilder::offset([&](FlatBuilder & g) { return g.structs(buffers, buffers.size() / 16); })
+        });
+    }, body.size());
+
+    return writeMessage(metadata, body, true);
+}
+
+bool ArrowWriter::close()
+{
+    if(_closed) return true;
+    if(!start(QVector<Field>())) return false;
+
+    _closed = true;
+
+    QByteArray tail;
+    FlatBuilder::append(tail, ArrowContinuation, sizeof (quint32));
+    FlatBuilder::append(tail, 0, sizeof (quint32));
+
+    if(_format == File)
+    {
+       QByteArray blocks;
+
+       for(const Block & block : std::as_const(_blocks))
+       {
+           FlatBuilder::append(blocks, block.offset, sizeof (qint64));
+           FlatBuilder::append(blocks, block.metadata, sizeof (qint64));
+           FlatBuilder::append(blocks, block.body, sizeof (qint64));
+       }
+
+       FlatBuilder flat;
+       const QVector<Field> fields = _fields;
+       const int count = _blocks.size();
+
+       const QByteArray footer = flat.finish([&](FlatBuilder & f)
+       {
+           return f.table({
+               FlatBuilder::scalar(sizeof (qint16), ArrowMetadataV5),
+               FlatBuilder::offset([&fields](FlatBuilder & g) { return arrowSchema(g, fields); }),
+               FlatBuilder::offset([](FlatBuilder & g) { return g.structs(QByteArray(), 0); }),
+               FlatBuilder::offset([&](FlatBuilder & g) { return g.structs(blocks, count); })
+           });
+       });
+
+       tail.append(footer);
+       FlatBuilder::append(tail, footer.size(), sizeof (qint32));
+       tail.append("ARROW1", 6);
+    }
+
+    return put(tail);
+}
+
+bool ArrowWriter::start(const QVector<Field> & fields)
+{
+    if(_closed)
+    {
+       _error = QObject::tr("The Arrow writer is closed");
+       return false;
+    }
+
+    if(_device == nullptr || !_device->isWritable())
+    {
+       _error = QObject::tr("The Arrow device is not writable");
+       return false;
+    }
+
+    if(_started)
+    {
+       if(fields.isEmpty() || fields.size() == _fields.size()) return true;
+
+       _error = QObject::tr("The result does not match the Arrow schema");
+       return false;
+    }
+
+    _started = true;
+    _fields = fields;
+
+    if(_format == File && !put(QByteArray("ARROW1\0\0", 8))) return false;
+
+    const QByteArray metadata = arrowMessage(ArrowSchemaHeader, [&fields](FlatBuilder & f) { return arrowSchema(f, fields); }, 0);
+    return writeMessage(metadata, QByteArray(), false);
+}
+
+bool ArrowWriter::writeMessage(const QByteArray & metadata, const QByteArray & body, bool batch)
+{
+    QByteArray prefix;
+    FlatBuilder::append(prefix, ArrowContinuation, sizeof (quint32));
+    FlatBuilder::append(prefix, metadata.size(), sizeof (qint32));
+
+    if(batch) _blocks.append({_position, prefix.size() + metadata.size(), body.size()});
+
+    return put(prefix) && put(metadata) && put(body);
+}
+
+bool ArrowWriter::put(const QByteArray & data)
+{
+    if(data.isEmpty()) return true;
+
+    if(_device->write(data) != data.size())
+    {
+       _error = _device->errorString();
+       return false;
+    }
+
+    _position += data.size();
+    return true;
+}
+
+//Numeric=================================================================================================
+//========================================================================================================
+
+Numeric Numeric::fromString(const QString & text, bool * ok)
+{
+    const QByteArray s = text.trimmed().toLatin1();
+    const QByteArray lower = s.toLower();
+
+    if(ok != nullptr) *ok = true;
+
+    Numeric n;
+
+    if(lower == "nan") n._data = numericBinary(NumericNaN, 0, 0);
+    else if(lower == "infinity" || lower == "+infinity") n._data = numericBinary(NumericPositiveInfinity, 0, 0);
+    else if(lower == "-infinity") n._data = numericBinary(NumericNegativeInfinity, 0, 0);
+
+    if(!n._data.isEmpty()) return n;
+    if(ok != nullptr) *ok = false;
+
+    quint16 sign = NumericPositive;
+    int pos = 0, point = -1;
+    QByteArray digits;
+
+    if(pos < s.size() && (s[pos] == '+' || s[pos] == '-'))
+    {
+       if(s[pos] == '-') sign = NumericNegative;
+       pos++;
+    }
+
+    for(; pos < s.size(); pos++)
+    {
+        char c = s[pos];
+
+        if(c >= '0' && c <= '9') digits.append(c);
+        else if(c == '.' && point < 0) point = digits.size();
+        else break;
+    }
+
+    if(digits.isEmpty()) return n;
+    if(point < 0) point = digits.size();
+
+    int scale = digits.size() - point;
+
+    if(pos < s.size() && (s[pos] == 'e' || s[pos] == 'E'))
+    {
+       bool valid = false;
+       int exponent = s.mid(pos + 1).toInt(&valid);
+
+       if(!valid || std::abs(exponent) > NumericMaxScale * 4) return n;
+
+       point += exponent;
+       scale -= exponent;
+       pos = s.size();
+    }
+
+    if(pos != s.size()) return n;
+
+    int lead = (4 - (point % 4 + 4) % 4) % 4;
+    int weight = (point + lead) / 4 - 1;
+
+    digits.prepend(QByteArray(lead, '0'));
+    if(digits.size() % 4 != 0) digits.append(4 - digits.size() % 4, '0');
+
+    QVector<qint16> groups;
+    groups.reserve(digits.size() / 4);
+
+    for(int i = 0; i < digits.size(); i += 4) groups.append(qint16(digits.mid(i, 4).toInt()));
+
+    int first = 0, last = groups.size();
+
+    while(first < last && groups[first] == 0)
+    {
+        first++;
+        weight--;
+    }
+
+    while(last > first && groups[last - 1] == 0) last--;
+
+    if(first == last)
+    {
+       weight = 0;
+       sign = NumericPositive;
+    }
+
+    if(weight < std::numeric_limits<qint16>::min() || weight > std::numeric_limits<qint16>::max()) return n;
+
+    n._data = numericBinary(sign, qint16(weight), quint16(qBound(0, scale, NumericMaxScale)), groups.mid(first, last - first));
+    if(ok != nullptr) *ok = true;
+    return n;
+}
+
+Numeric Numeric::fromLongLong(qint64 value)
+{
+    quint64 magnitude = (value < 0) ? 0 - quint64(value) : quint64(value);
+    QVector<qint16> groups;
+
+    while(magnitude > 0)
+    {
+        groups.prepend(qint16(magnitude % NumericBase));
+        magnitude /= NumericBase;
+    }
+
+    qint16 weight = qint16(groups.size() - 1);
+    while(!groups.isEmpty() && groups.last() == 0) groups.removeLast();
+
+    Numeric n;
+    n._data = numericBinary((value < 0) ? NumericNegative : NumericPositive, groups.isEmpty() ? 0 : weight, 0, groups);
+    return n;
+}
+
+Numeric Numeric::fromDouble(double value)
+{
+    if(std::isnan(value)) return fromString(QStringLiteral("NaN"));
+    if(std::isinf(value)) return fromString((value < 0) ? QStringLiteral("-Infinity") : QStringLiteral("Infinity"));
+
+    return fromString(QString::number(value, 'g', QLocale::FloatingPointShortest));
+}
+
+bool Numeric::isNull() const
+{
+    return _data.isEmpty();
+}
+
+bool Numeric::isNaN() const
+{
+    return NumericHeader(_data.constData(), _data.size()).sign == NumericNaN;
+}
+
+bool Numeric::isNegative() const
+{
+    quint16 sign = NumericHeader(_data.constData(), _data.size()).sign;
+    return sign == NumericNegative || sign == NumericNegativeInfinity;
+}
+
+int Numeric::scale() const
+{
+    return NumericHeader(_data.constData(), _data.size()).scale;
+}
+
+QString Numeric::toString() const
+{
+    return numericToString(_data.constData(), _data.size());
+}
+
+double Numeric::toDouble() const
+{
+    return numericToDouble(_data.constData(), _data.size());
+}
+
+qint64 Numeric::toLongLong(bool * ok) const
+{
+    return numericToLongLong(_data.constData(), _data.size(), ok);
+}
+
+QDebug operator << (QDebug debug, const Numeric & numeric)
+{
+    QDebugStateSaver saver(debug);
+    debug.nospace() << "Numeric(" << numeric.toString() << ')';
+    return debug;
+}
+
+//Cluster=================================================================================================
+//========================================================================================================
+
+#define ProbeInterval 1000
+#define ProbeTimeoutIntervals 5
+#define LatencySmoothing 0.2
+
+Cluster::Cluster(QObject * parent) : QObject(parent)
+{
+    _timer.setInterval(ProbeInterval);
+    connect(&_timer, &QTimer::timeout, this, &Cluster::heartbeat);
+}
+
+Cluster::~Cluster()
+{
+    clear();
+}
+
+bool Cluster::isConnect() const
+{
+    return _connected;
+}
+
+void Cluster::connection(const QVector<QPair<QHostAddress, quint16>> & hosts, const QString & user, const QString & password, const QString & database, TargetSessionAttrs target)
+{
+    clear();
+
+    _user = user;
+    _password = password;
+    _database = database;
+    _target = target;
+
+    _hosts.resize(hosts.size());
+
+    for(int i = 0; i < hosts.size(); i++)
+    {
+        Host & host = _hosts[i];
+        host._address = hosts[i].first;
+        host._port = hosts[i].second;
+        host._db = new Connection(this);
+        host._probe = new Query(host._db, this);
+
+        connect(host._db, &Connection::connected, this, [this, i]()
+        {
+            _hosts[i]._connecting = false;
+            probe(i);
+        });
+
+        connect(host._db, &Connection::disconnected, this, [this, i](){ hostLost(i); });
+        connect(host._db, &Connection::error, this, [this, i](const Message &)
+        {
+            if(!_hosts[i]._db->isConnect()) hostLost(i);
+        });
+
+        connect(host._probe, &Query::executeFinished, this, [this, i](){ probeFinished(i); });
+        connect(host._probe, &Query::error, this, [this, i](const Message &)
+        {
+            _hosts[i]._probeFailed = true;
+            if(!_hosts[i]._db->isConnect()) hostLost(i);
+        });
+
+        connectHost(i);
+    }
+
+    _timer.start();
+}
+
+Connection * Cluster::session(TargetSessionAttrs attrs) const
+{
+    if(attrs == TargetSessionAttrs::PreferStandby)
+    {
+       Connection * db = session(TargetSessionAttrs::ReadOnly);
+       return (db != nullptr) ? db : session(TargetSessionAttrs::ReadWrite);
+    }
+
+    const Host * best = nullptr;
+
+    for(const Host & host : _hosts)
+    {
+        if(!host._healthy || !host._db->isConnect()) continue;
+        if(attrs == TargetSessionAttrs::ReadWrite && host._readOnly) continue;
+        if(attrs == TargetSessionAttrs::ReadOnly && !host._readOnly) continue;
+
+        if(best == nullptr || host.latency() < best->latency()) best = &host;
+    }
+
+    return (best != nullptr) ? best->_db : nullptr;
+}
+
+Connection * Cluster::writer() const
+{
+    return session(TargetSessionAttrs::ReadWrite);
+}
+
+Connection * Cluster::reader() const
+{
+    return session(TargetSessionAttrs::PreferStandby);
+}
+
+const QVector<Host> & Cluster::hosts() const
+{
+    return _hosts;
+}
+
+int Cluster::probeInterval() const
+{
+    return _timer.interval();
+}
+
+void Cluster::setProbeInterval(int msec)
+{
+    _timer.setInterval(msec);
+}
+
+void Cluster::close()
+{
+    _timer.stop();
+
+    for(int i = 0; i < _hosts.size(); i++)
+    {
+        _hosts[i]._db->close();
+        hostLost(i);
+    }
+}
+
+void Cluster::clear()
+{
+    _timer.stop();
+
+    for(Host & host : _hosts)
+    {
+        host._db->disconnect(this);
+        host._probe->disconnect(this);
+
+        delete host._db;
+        delete host._probe;
+    }
+
+    _hosts.clear();
+    updateState();
+}
+
+void Cluster::connectHost(int index)
+{
+    Host & host = _hosts[index];
+    host._db->connection(host._address, host._port, _user, _password, _database);
+    host._connecting = true;
+    host._probeTimer.start();
+}
+
+void Cluster::probe(int index)
+{
+    Host & host = _hosts[index];
+    if(host._probing || !host._db->isConnect()) return;
+
+    host._probing = true;
+    host._probeFailed = false;
+    host._probeTimer.start();
+    host._probe->exec("select pg_catalog.pg_is_in_recovery()");
+}
+
+void Cluster::probeFinished(int index)
+{
+    Host & host = _hosts[index];
+    if(!host._probing) return;
+
+    host._probing = false;
+
+    if(host._probeFailed || host._probe->rowCount() == 0)
+    {
+       hostLost(index);
+       return;
+    }
+
+    double rtt = host._probeTimer.nsecsElapsed() / 1000000.0;
+    bool readOnly = host._probe->value(0, 0).toBool();
+    bool changed = !host._healthy || host._readOnly != readOnly;
+
+    host._latency = (host._latency < 0) ? rtt : host._latency + LatencySmoothing * (rtt - host._latency);
+    host._healthy = true;
+    host._readOnly = readOnly;
+
+    if(changed) emit hostChanged(index);
+    updateState();
+}
+
+void Cluster::hostLost(int index)
+{
+    Host & host = _hosts[index];
+    bool changed = host._healthy;
+
+    host._connecting = false;
+    host._probing = false;
+    host._healthy = false;
+
+    if(changed) emit hostChanged(index);
+    updateState();
+}
+
+void Cluster::updateState()
+{
+    bool ready = session(_target) != nullptr;
+    if(ready == _connected) return;
+
+    _connected = ready;
+
+    if(ready) emit connected();
+    else
+    {
+       if(!_hosts.isEmpty())
+       {
+          Message e;
+          e._message = tr("No host matching the target session attributes is available");
+          emit error(e);
+       }
+
+       emit disconnected();
+    }
+}
+
+void Cluster::heartbeat()
+{
+    const qint64 timeout = qint64(_timer.interval()) * ProbeTimeoutIntervals;
+
+    for(int i = 0; i < _hosts.size(); i++)
+    {
+        Host & host = _hosts[i];
+
+        if(host._connecting)
+        {
+           if(host._probeTimer.elapsed() > timeout)
+           {
+              host._db->close();
+              hostLost(i);
+           }
+        }
+        else if(!host._db->isConnect()) connectHost(i);
+        else if(host._probing)
+        {
+           if(host._probeTimer.elapsed() > timeout) host._db->close();
+        }
+        else probe(i);
+    }
+}
+
+//Host====================================================================================================
+//========================================================================================================
+
+const QHostAddress & Host::address() const
+{
+    return _address;
+}
+
+quint16 Host::port() const
+{
+    return _port;
+}
+
+Connection * Host::connection() const
+{
+    return _db;
+}
+
+bool Host::isHealthy() const
+{
+    return _healthy;
+}
+
+bool Host::isReadOnly() const
+{
+    return _readOnly;
+}
+
+double Host::latency() const
+{
+    if(_probing && _latency >= 0) return qMax(_latency, _probeTimer.nsecsElapsed() / 1000000.0);
+    return _latency;
+}
+
+QDebug operator << (QDebug debug, const Host & host)
+{
+    QDebugStateSaver saver(debug);
+
+    debug.nospace() << "Host(Address: " << host._address.toString() << ",\n"
+                    << "     Port: " << host._port << ",\n"
+                    << "     Healthy: " << host._healthy << ",\n"
+                    << "     Read only: " << host._readOnly << ",\n"
+                    << "     Latency: " << host.latency() << ')';
+    return debug;
+}
+
+//Replication=============================================================================================
+//========================================================================================================
+
+#define StatusInterval 10000
+#define StandbyStatusSize 34
+#define XLogDataHeaderSize 25
+#define KeepaliveSize 18
+
+Replication::Replication(Connection * db, QObject * parent) : QObject(parent), _db(db)
+{
+    _timer.setInterval(StatusInterval);
+    connect(&_timer, &QTimer::timeout, this, &Replication::sendStatus);
+
+    if(db == nullptr) return;
+
+    db->_replication = this;
+
+    connect(db, &Connection::error, this, [this](const Message & e)
+    {
+        if(!_starting && !_active) return;
+
+        emit error(e);
+        reset();
+        emit stopped();
+    });
+
+    connect(db, &Connection::disconnected, this, [this]()
+    {
+        if(!_starting && !_active) return;
+
+        reset();
+        emit stopped();
+    });
+}
+
+Replication::~Replication()
+{
+    if(!_db.isNull() && _db->_replication == this) _db->_replication = nullptr;
+}
+
+bool Replication::isActive() const
+{
+    return _active;
+}
+
+void Replication::start(const QString & slot, const QStringList & publications, quint64 lsn)
+{
+    if(_db.isNull() || _db->_replication != this)
+    {
+       fail(tr("Replication is not attached to a connection"));
+       return;
+    }
+
+    if(!_db->isConnect() || !_db->_tasks.isEmpty() || _starting || _active)
+    {
+       fail(tr("The connection is not idle"));
+       return;
+    }
+
+    QStringList names;
+    for(const QString & name : publications) names.append("\"" + QString(name).replace('"', "\"\"") + "\"");
+
+    const QByteArray command = ("START_REPLICATION SLOT \"" + QString(slot).replace('"', "\"\"") + "\" LOGICAL " + lsnToString(lsn) +
+                                " (proto_version '1', publication_names '" + names.join(',').replace('\'', "''") + "', binary 'true')").toUtf8();
+
+    QByteArray out;
+    const quint32 size = qToBigEndian(quint32(sizeof (quint32) + command.size() + 1));
+
+    out.append(char(SimpleQuery));
+    out.append(reinterpret_cast<const char *>(&size), sizeof (size));
+    out.append(command);
+    out.append(char(0));
+
+    _relations.clear();
+    _received = lsn;
+    _flushed = lsn;
+    _transaction = false;
+    _starting = true;
+
+    _db->send(out);
+}
+
+void Replication::stop()
+{
+    const char done[] = {CopyDone, 0x00, 0x00, 0x00, 0x04};
+
+    if(_db.isNull() || !_active || _stopping) return;
+
+    sendStatus();
+    _stopping = true;
+    _db->send(done, sizeof (done));
+}
+
+quint64 Replication::receivedLsn() const
+{
+    return _received;
+}
+
+quint64 Replication::acknowledgedLsn() const
+{
+    return _flushed;
+}
+
+void Replication::acknowledge(quint64 lsn)
+{
+    if(lsn > _flushed) _flushed = lsn;
+}
+
+bool Replication::autoAcknowledge() const
+{
+    return _auto;
+}
+
+void Replication::setAutoAcknowledge(bool enable)
+{
+    _auto = enable;
+}
+
+int Replication::statusInterval() const
+{
+    return _timer.interval();
+}
+
+void Replication::setStatusInterval(int msec)
+{
+    _timer.setInterval(msec);
+}
+
+QString Replication::lsnToString(quint64 lsn)
+{
+    return QString::number(lsn >> 32, 16).toUpper() + '/' + QString::number(lsn & 0xFFFFFFFF, 16).toUpper();
+}
+
+quint64 Replication::lsnFromString(const QString & lsn, bool * ok)
+{
+    const QStringList parts = lsn.split('/');
+    bool high = false, low = false;
+    quint64 value = 0;
+
+    if(parts.size() == 2) value = (parts[0].toULongLong(&high, 16) << 32) | parts[1].toULongLong(&low, 16);
+    if(ok != nullptr) *ok = high && low;
+
+    return (high && low) ? value : 0;
+}
+
+void Replication::copyBoth()
+{
+    if(!_starting) return;
+
+    _starting = false;
+    _active = true;
+    _timer.start();
+
+    emit started();
+}
+
+void Replication::copyData(const char * data, quint32 size)
+{
+    if(!_active || size == 0) return;
+
+    if(data[0] == 'w' && size >= XLogDataHeaderSize)
+    {
+       const quint64 lsn = qFromBigEndian<quint64>(data + 1);
+       if(lsn > _received) _received = lsn;
+
+       logical(data + XLogDataHeaderSize, data + size, lsn);
+    }
+    else if(data[0] == 'k' && size >= KeepaliveSize)
+    {
+       const quint64 end = qFromBigEndian<quint64>(data + 1);
+
+       if(end > _received) _received = end;
+       if(_auto && !_transaction && end > _flushed) _flushed = end;
+       if(data[KeepaliveSize - 1] != 0) sendStatus();
+    }
+}
+
+void Replication::copyDone()
+{
+    const char done[] = {CopyDone, 0x00, 0x00, 0x00, 0x04};
+
+    if(!_active) return;
+    if(!_stopping) _db->send(done, sizeof (done));
+
+    reset();
+    emit stopped();
 }
 
-void Connection::analyzePacket()
+void Replication::logical(const char * data, const char * end, quint64 lsn)
 {
-    constexpr auto proto = GotoPointers<std::numeric_limits<quint8>::max()>(
+    if(data >= end) return;
 
-      &&_default,
+    const char type = *data++;
+    const qint64 left = end - data;
 
-      {
-        {DataRow, &&_DataRow},
-        {NoData, &&_next},
-        {ParameterDescription, &&_ParameterDescription},
-        {RowDescription, &&_RowDescription},
-        {ReadyForQuery, &&_ReadyForQuery},
-        {CommandCompletion, &&_CommandCompletion},
-        {EmptyQueryResponse, &&_next},
-        {ParseComplite, &&_next},
-        {BindCompletion, &&_next},
-        {ErrorResponse, &&_ErrorResponse},
-        {NoticeResponse, &&_NoticeResponse},
-        {ParameterStatus, &&_ParameterStatus},
-        {AuthenticationRequest, &&_AuthenticationRequest},
-        {BackendKeyData, &&_BackendKeyData},
-        {NegotiateProtocolVersion, &&_NegotiateProtocolVersion},
-      }
-    );
+    if(type == 'B' && left >= 20)
+    {
+       _xid = qFromBigEndian<quint32>(data + 2 * sizeof (quint64));
+       _transaction = true;
 
-    bool complete = false;
+       emit begin(_xid, qFromBigEndian<quint64>(data), Binary<QDateTime>::read(data + sizeof (quint64), sizeof (quint64)));
+       return;
+    }
 
-    quint32 pos = 0;
-    QByteArray data = _bufferIn + _socket.readAll();
-    _bufferIn.clear();
+    if(type == 'C' && left >= 25)
+    {
+       const quint64 position = qFromBigEndian<quint64>(data + 1 + sizeof (quint64));
+       _transaction = false;
+
+       emit commit(_xid, position, Binary<QDateTime>::read(data + 1 + 2 * sizeof (quint64), sizeof (quint64)));
+       if(_auto) acknowledge(position);
+       return;
+    }
 
-    if(data.size() < MinimumPackageSize)
+    if(type == 'R')
     {
-       Message e;
-       e._message = tr("Minimum data packet size error");
-       emit error(e);
-       close();
+       if(!relationMessage(data, end)) fail(tr("Malformed relation message"));
        return;
     }
 
-    do
+    if(type == 'T' && left >= 5)
     {
-       quint32 size = qFromBigEndian<quint32>(data.data() + pos + 1);
+       const quint32 count = qFromBigEndian<quint32>(data);
+       data += sizeof (quint32) + 1;
 
-       if(static_cast<quint32>(data.size()) <= pos + size)
+       for(quint32 i = 0; i < count && end - data >= 4; i++, data += sizeof (quint32))
        {
-          if(complete)
-          {
-             Message e;
-             e._message = tr("Protocol message size error");
-             emit error(e);
-             close();
-             return;
-          }
+           auto relation = _relations.constFind(qFromBigEndian<quint32>(data));
+           if(relation == _relations.constEnd()) continue;
 
-          _bufferIn = data.mid(pos);
-          return;
+           Change change;
+           change._type = Change::Type::Truncate;
+           change._xid = _xid;
+           change._lsn = lsn;
+           change._relation = *relation;
+
+           emit this->change(change);
        }
 
-       goto *proto.pointers[data[pos]];
+       return;
+    }
 
-       _DataRow: dataRow(data.data() + pos + MinimumPackageSize, size - sizeof (quint32));
-        goto _next;
+    if((type != 'I' && type != 'U' && type != 'D') || left < 5) return;
 
-       _ParameterDescription: preparedParametrs(data.data() + pos + MinimumPackageSize, size - sizeof (quint32));
-        goto _next;
+    auto relation = _relations.constFind(qFromBigEndian<quint32>(data));
+    data += sizeof (quint32);
 
-       _RowDescription: rowDescription(data.data() + pos + MinimumPackageSize);
-        goto _next;
+    if(relation == _relations.constEnd())
+    {
+       fail(tr("Change for an unknown relation"));
+       return;
+    }
 
-       _ReadyForQuery: readyForQuery(data.data() + pos + MinimumPackageSize);
-        goto _next;
+    Change change;
+    change._xid = _xid;
+    change._lsn = lsn;
+    change._relation = *relation;
+    change._type = (type == 'I') ? Change::Type::Insert : (type == 'U') ? Change::Type::Update : Change::Type::Delete;
 
-       _CommandCompletion: complete = true;
-        goto _next;
+    bool ok = true;
 
-       _ErrorResponse: errorOrNoticeResponse(data.data() + pos + MinimumPackageSize, size - sizeof (quint32), ErrorOrNotice::Error);
-        goto _next;
+    if(type != 'I' && (*data == 'K' || *data == 'O'))
+    {
+       data++;
+       ok = tuple(*relation, data, end, change._oldValues, nullptr);
+    }
 
-       _NoticeResponse: errorOrNoticeResponse(data.data() + pos + MinimumPackageSize, size - sizeof (quint32), ErrorOrNotice::Notice);
-        goto _next;
+    if(ok && type != 'D')
+    {
+       ok = data < end && *data == 'N';
+       data++;
+       ok = ok && tuple(*relation, data, end, change._values, &change._unchanged);
+    }
 
-       _ParameterStatus: parameterStatus(data.data() + pos + MinimumPackageSize);
-        goto _next;
+    if(!ok)
+    {
+       fail(tr("Malformed tuple data"));
+       return;
+    }
 
-       _AuthenticationRequest:
+    emit this->change(change);
+}
 
-        if(!authentication(data.data() + pos + MinimumPackageSize))
-        {
-           Message e;
-           e._message = tr("Authorization error");
-           emit error(e);
-           close();
-           return;
-        }
+bool Replication::relationMessage(const char * data, const char * end)
+{
+    auto string = [&data, end](QString & out)
+    {
+        const char * zero = static_cast<const char *>(std::memchr(data, 0, end - data));
+        if(zero == nullptr) return false;
 
-        goto _next;
+        out = utf8String(data, zero - data);
+        data = zero + 1;
+        return true;
+    };
 
-       _BackendKeyData : backendKeyData(data.data() + pos + MinimumPackageSize);
-        goto _next;
+    if(end - data < 4) return false;
 
-       _NegotiateProtocolVersion :
-        {
-          Message e;
-          e._message = tr("Protocol version 3.0 is not supported");
-          emit error(e);
-          close();
-          return;
-        }
+    Relation relation;
+    relation._oid = qFromBigEndian<quint32>(data);
+    data += sizeof (quint32);
 
-        _default:
-        {
-          Message e;
-          e._message = tr("Does not support the type of message in the protocol: ") + data[pos];
-          emit error(e);
-          close();
-          return;
-        }
+    if(!string(relation._schema) || !string(relation._name) || end - data < 3) return false;
 
-       _next:
-       pos += size;
-       pos++;
-    }
-    while(pos + MinimumPackageSize <= static_cast<quint32>(data.size()));
+    relation._identity = *data++;
+    const quint16 count = qFromBigEndian<quint16>(data);
+    data += sizeof (quint16);
 
-    if(pos != static_cast<quint32>(data.size()))
+    Result::Data & description = *relation._description._d;
+    description.fields.reserve(count);
+    relation._keys.reserve(count);
+
+    for(quint16 i = 0; i < count; i++)
     {
-       if(complete)
-       {
-          Message e;
-          e._message = tr("Data segmentation error");
-          emit error(e);
-          close();
-       }
+        if(end - data < 1) return false;
 
-       _bufferIn = data.mid(pos);
-       return;
-    }
-}
+        Field field;
+        const bool key = (*data++ & 1) != 0;
 
-//Query===================================================================================================
-//========================================================================================================
+        if(!string(field._name) || end - data < 8) return false;
 
-quint64 Query::_stmt_number = 0;
-Query::Query(Connection * db, QObject * parent) : QObject(parent), _db(db){}
+        field._tableOID = relation._oid;
+        field._columnIndex = i + 1;
+        field._typeOID = qFromBigEndian<quint32>(data);
+        field._typeSize = -1;
+        field._typeModifier = qFromBigEndian<qint32>(data + sizeof (quint32));
+        field._formatType = 1;
+        data += 2 * sizeof (quint32);
 
-Query::~Query()
-{
-    for(char * row : std::as_const(_dataRows)) delete[] row;
-}
+        _db->describeField(field);
 
-const QString & Query::lastQuery() const
-{
-    return _lastQuery;
+        if(!description.names.contains(field._name)) description.names.insert(field._name, i);
+        description.fields.append(std::move(field));
+        relation._keys.append(key);
+    }
+
+    _relations.insert(relation._oid, relation);
+    emit this->relation(relation);
+    return true;
 }
 
-void Query::exec()
+bool Replication::tuple(const Relation & relation, const char *& data, const char * end, QVariantList & values, QVector<bool> * unchanged) const
 {
-    if(_db == nullptr) return;
+    if(end - data < 2) return false;
 
-    if(_prepare)
+    const quint16 count = qFromBigEndian<quint16>(data);
+    const int columns = relation._description.columnCount();
+    data += sizeof (quint16);
+
+    values.clear();
+    values.reserve(count);
+    if(unchanged != nullptr) unchanged->fill(false, count);
+
+    for(quint16 i = 0; i < count; i++)
     {
-        if(_prepareFinished) _db->addQuery(this);
+        if(data >= end) return false;
+
+        const char kind = *data++;
+
+        if(kind == 'n' || kind == 'u')
+        {
+           values.append(QVariant());
+           if(kind == 'u' && unchanged != nullptr) (*unchanged)[i] = true;
+           continue;
+        }
+
+        if((kind != 'b' && kind != 't') || end - data < 4) return false;
+
+        const qint32 size = qFromBigEndian<qint32>(data);
+        data += sizeof (qint32);
+
+        if(size < 0 || end - data < size) return false;
+
+        values.append((kind == 'b' && i < columns) ? relation._description.decode(i, data, size) : QVariant(utf8String(data, size)));
+        data += size;
     }
-    else if(!_lastQuery.isEmpty()) _db->addQuery(this);
+
+    return true;
 }
 
-void Query::exec(const QString & query)
+void Replication::sendStatus()
 {
-    if(_db == nullptr) return;
-    _prepare = false;
-    preparation(query);
+    if(_db.isNull() || !_active || _stopping) return;
+
+    char out[MinimumPackageSize + StandbyStatusSize];
+    const quint32 size = qToBigEndian(quint32(sizeof (quint32) + StandbyStatusSize));
+    const quint64 positions[] = {qToBigEndian(_received), qToBigEndian(_flushed), qToBigEndian(_flushed),
+                                 qToBigEndian(quint64((QDateTime::currentMSecsSinceEpoch() - PostgresEpochMSecs) * 1000))};
+
+    out[0] = CopyData;
+    std::memcpy(out + 1, &size, sizeof (size));
+    out[MinimumPackageSize] = 'r';
+    std::memcpy(out + MinimumPackageSize + 1, positions, sizeof (positions));
+    out[sizeof (out) - 1] = 0;
+
+    _db->send(out, sizeof (out));
 }
 
-void Query::prepare(const QString & query)
+void Replication::reset()
 {
-    if(_db == nullptr) return;
-    _prepare = true;
-    _stmt_number++;
-    _stmtName = "stmt_" + QByteArray::number(_stmt_number);
-    preparation(query);
+    _timer.stop();
+    _starting = false;
+    _active = false;
+    _stopping = false;
+    _transaction = false;
 }
 
-const QVector<QVariant> & Query::bindValues() const
+void Replication::fail(const QString & message)
 {
-    return _bindValues;
+    Message e;
+    e._message = message;
+    emit error(e);
 }
 
-void Query::bindValue(int index, const std::variant<qint16, qint32, QVariant> & value)
+//Relation================================================================================================
+//========================================================================================================
+
+quint32 Relation::oid() const
 {
-    if(_db == nullptr || !_prepareFinished) return;
-    _bindValues.insert(index, QVariant::fromStdVariant(value));
+    return _oid;
 }
 
-const QVector<Field> & Query::fields() const
+const QString & Relation::schema() const
 {
-    return _fields;
+    return _schema;
 }
 
-int Query::rowCount() const
+const QString & Relation::name() const
 {
-    return _dataRows.size();
+    return _name;
 }
 
-int Query::columnCount() const
+char Relation::replicaIdentity() const
 {
-    return _fields.size();
+    return _identity;
 }
 
-QVariant Query::value(int row, int column) const
+const QVector<Field> & Relation::fields() const
 {
-    constexpr auto types = GotoPointers<TypeMax()>(
-
-        &&_BYTEA,
-
-        {
-            {BOOL, &&_BOOL},
-            {INT2, &&_INT2},
-            {INT4, &&_INT4},
-            {INT8, &&_INT8},
-            {FLOAT4, &&_FLOAT4},
-            {FLOAT8, &&_FLOAT8},
-            {DATE, &&_DATE},
-            {TIME, &&_TIME},
-            {TIMETZ, &&_TIMETZ},
-            {TIMESTAMP, &&_TIMESTAMP},
-            {BYTEA, &&_BYTEA},
-            {TEXT, &&_TEXT},
-            {UUID, &&_UUID}
-        }
-    );
-
-    char * data = _dataRows[row];
-
-    for(int i = 0; i <= _fields.count(); i++)
-    {
-        quint32 size = qFromBigEndian<quint32>(data);
-        data += sizeof (quint32);
-
-        if(i == column)
-        {
-           if(size == -1) return QVariant();
-
-           if(types.size() < _fields[i]._typeOID) goto _BYTEA;
-           else goto *types.pointers[_fields[i]._typeOID];
-
-           _BOOL:
-            return (data[0] == 0) ? false : true;
-
-           _INT2:
-            return QVariant::fromValue(qFromBigEndian<qint16>(data));
-
-           _INT4:
-            return qFromBigEndian<qint32>(data);
-
-           _INT8:
-            return qFromBigEndian<qint64>(data);
-
-           _FLOAT4:
-            return QVariant::fromValue(qFromBigEndian<float>(data));
-
-           _FLOAT8:
-            return qFromBigEndian<double>(data);
-
-           _DATE:
-            return QDate(2000, 1, 1).addDays(qFromBigEndian<qint32>(data));
-
-           _TIME:
-            return QTime::fromMSecsSinceStartOfDay(qFromBigEndian<qint64>(data)/1000);
-
-           _TIMETZ:
-            return QDateTime(QDate::fromJulianDay(0),
-                             QTime::fromMSecsSinceStartOfDay(qFromBigEndian<qint64>(data)/1000),
-                             QTimeZone(-qFromBigEndian<qint32>(data + sizeof (qint64))));
-
-           _TIMESTAMP:
-            return QDateTime::fromMSecsSinceEpoch(946674000000 + qFromBigEndian<qint64>(data)/1000);
+    return _description.fields();
+}
 
-           _BYTEA:
-            return QByteArray(data, size);
+bool Relation::isKey(int column) const
+{
+    return column >= 0 && column < _keys.size() && _keys[column];
+}
 
-           _TEXT:
-            return QString(QLatin1String(data, size));
+QDebug operator << (QDebug debug, const Relation & relation)
+{
+    QDebugStateSaver saver(debug);
+    debug.nospace() << "Relation(" << relation._oid << ", " << relation._schema << '.' << relation._name << ')';
+    return debug;
+}
 
-           _UUID:
-            return QUuid::fromRfc4122(QByteArray(data, 16));
-        }
-        else if(size != -1) data += size;
-    }
+//Change==================================================================================================
+//========================================================================================================
 
-    return QVariant();
+Change::Type Change::type() const
+{
+    return _type;
 }
 
-void Query::preparation(const QString & query)
+quint32 Change::xid() const
 {
-    _fields.clear();
-    _preparedParametrs.clear();
-    _bindValues.clear();
+    return _xid;
+}
 
-    for(char * row : std::as_const(_dataRows)) delete[] row;
-    _dataRows.clear();
+quint64 Change::lsn() const
+{
+    return _lsn;
+}
 
-    _lastQuery = query;
-    _prepareFinished = false;
-    _db->addQuery(this);
+const Relation & Change::relation() const
+{
+    return _relation;
 }
 
-void Query::addPreparedParametr(quint32 oid)
+const QVariantList & Change::values() const
 {
-    _preparedParametrs.append(oid);
+    return _values;
 }
 
-void Query::addDataRow(const char * data, quint32 size)
+const QVariantList & Change::oldValues() const
 {
-    char * row = new char[size];
-    std::memcpy(row, data, size);
-    _dataRows.append(row);
+    return _oldValues;
 }
 
-QDebug operator << (QDebug debug, const Query & query)
+bool Change::isUnchanged(int column) const
 {
-    QDebugStateSaver saver(debug);
+    return column >= 0 && column < _unchanged.size() && _unchanged[column];
+}
 
-    debug.nospace() << "Query(Query: " << query._lastQuery << ",\n";
-    debug.nospace() << "      Prepare: " << query._prepare << ",\n";
-    debug.nospace() << "      Prepare finished: " << query._prepareFinished << ",\n";
-    debug.nospace() << "      Statement name: " << query._stmtName << ",\n";
-    debug.nospace() << "      Fields count: " << query._fields.count() << ",\n";
-    debug.nospace() << "      Prepared parametrs OID: ";
+//Codec===================================================================================================
+//========================================================================================================
 
-    bool first = false;
+Codec::Codec(const Decoder & decoder, const Encoder & encoder, QMetaType::Type type) : _decoder(decoder), _encoder(encoder), _type(type){}
 
-    for(const auto & v : query._preparedParametrs)
-    {
-        if(!first)
-        {
-           debug.nospace() << v;
-           first = true;
-        }
-        else
-        {
-            debug.nospace() << ", " << v;
-        }
-    }
+const Codec::Decoder & Codec::decoder() const
+{
+    return _decoder;
+}
 
-    debug.nospace() << '\n';
-    debug.nospace() << "      Number of binding values: " << query._bindValues.count() << ")";
+const Codec::Encoder & Codec::encoder() const
+{
+    return _encoder;
+}
 
-    return debug;
+QMetaType::Type Codec::type() const
+{
+    return _type;
 }
 
 //Field===================================================================================================
@@ -6,6 +6,27 @@
 #include <QTime>
 #include <QTimeZone>
 #include <QQueue>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QSharedPointer>
+#include <QPointer>
+#include <QIODevice>
+#include <QTemporaryFile>
+#include <QVarLengthArray>
+#include <QAbstractTableModel>
+#include <QThreadPool>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#if QT_VERSION >= 0x060000
+#include <QByteArrayView>
+#include <QUtf8StringView>
+#endif
 
 namespace TinyPG
 {
@@ -16,10 +37,35 @@ namespace TinyPG
 #define SHARED
 #endif
 
+class SHARED Codec final
+{
+    friend class Connection;
+    friend class Query;
+    friend class Result;
+
+public:
+    using Decoder = std::function<QVariant(const char * data, qint32 size)>;
+    using Encoder = std::function<bool(QByteArray & out, const QVariant & value)>;
+
+    explicit Codec(const Decoder & decoder = Decoder(), const Encoder & encoder = Encoder(), QMetaType::Type type = QMetaType::UnknownType);
+
+    const Decoder & decoder() const;
+    const Encoder & encoder() const;
+    QMetaType::Type type() const;
+
+private:
+    Decoder _decoder;
+    Encoder _encoder;
+    QMetaType::Type _type;
+};
+
+
 class SHARED Field final
 {
     friend class Connection;
     friend class Query;
+    friend class Result;
+    friend class Replication;
     friend QDebug operator << (QDebug debug, const Field & field);
 
     QString _name;
@@ -31,6 +77,9 @@ class SHARED Field final
     quint16 _formatType;
     QMetaType::Type _type;
 
+    QSharedPointer<const Codec> _codec;
+    quint8 _kind = 0;
+
     explicit Field();
 public:
     const QString & name() const;
@@ -46,9 +95,40 @@ public:
 QDebug operator << (QDebug debug, const Field & field);
 
 
+template<typename T> struct Binary;
+
+class SHARED Numeric final
+{
+    template<typename T> friend struct Binary;
+    friend class Connection;
+    friend QDebug operator << (QDebug debug, const Numeric & numeric);
+
+    QByteArray _data;
+
+public:
+    static Numeric fromString(const QString & text, bool * ok = nullptr);
+    static Numeric fromLongLong(qint64 value);
+    static Numeric fromDouble(double value);
+
+    bool isNull() const;
+    bool isNaN() const;
+    bool isNegative() const;
+    int scale() const;
+
+    QString toString() const;
+    double toDouble() const;
+    qint64 toLongLong(bool * ok = nullptr) const;
+};
+
+QDebug operator << (QDebug debug, const Numeric & numeric);
+
+
 class SHARED Message
 {
     friend class Connection;
+    friend class Query;
+    friend class Cluster;
+    friend class Replication;
     friend QDebug operator << (QDebug debug, const Message & error);
 
     QString _importance, _code, _message;
@@ -61,13 +141,267 @@ public:
 
 QDebug operator << (QDebug debug, const Message & error);
 
+template<typename T> struct Decodable : std::false_type {};
+template<> struct Decodable<bool> : std::true_type {};
+template<> struct Decodable<qint16> : std::true_type {};
+template<> struct Decodable<qint32> : std::true_type {};
+template<> struct Decodable<qint64> : std::true_type {};
+template<> struct Decodable<float> : std::true_type {};
+template<> struct Decodable<double> : std::true_type {};
+template<> struct Decodable<QDate> : std::true_type {};
+template<> struct Decodable<QTime> : std::true_type {};
+template<> struct Decodable<QDateTime> : std::true_type {};
+template<> struct Decodable<QByteArray> : std::true_type {};
+template<> struct Decodable<QString> : std::true_type {};
+template<> struct Decodable<QUuid> : std::true_type {};
+template<> struct Decodable<Numeric> : std::true_type {};
+template<> struct Decodable<QJsonDocument> : std::true_type {};
+
+template<typename C> struct DecodableArray : std::false_type {};
+template<typename T> struct DecodableArray<QVector<T>> : std::bool_constant<Decodable<T>::value && !std::is_same<T, QJsonDocument>::value> {};
+template<typename T> struct DecodableArray<std::vector<T>> : DecodableArray<QVector<T>> {};
+
+template<typename T, typename = void> struct Bindable
+{
+    using type = void;
+};
+
+template<typename T> struct Bindable<T, std::enable_if_t<Decodable<T>::value>>
+{
+    using type = T;
+    static const T & convert(const T & value) { return value; }
+};
+
+template<typename T> struct Bindable<T, std::enable_if_t<std::is_integral<T>::value && !Decodable<T>::value>>
+{
+    using type = std::conditional_t<(sizeof (T) < sizeof (qint32) || (sizeof (T) == sizeof (qint32) && std::is_signed<T>::value)), qint32, qint64>;
+    static type convert(T value) { return type(value); }
+};
+
+template<typename T> struct Bindable<T, std::enable_if_t<std::is_floating_point<T>::value && !Decodable<T>::value>>
+{
+    using type = double;
+    static double convert(T value) { return double(value); }
+};
+
+template<> struct Bindable<const char *>
+{
+    using type = QString;
+    static QString convert(const char * value) { return QString::fromUtf8(value); }
+};
+
+template<> struct Bindable<char *> : Bindable<const char *>{};
+
+template<> struct Bindable<QJsonObject>
+{
+    using type = QJsonDocument;
+    static QJsonDocument convert(const QJsonObject & value) { return QJsonDocument(value); }
+};
+
+template<> struct Bindable<QJsonArray>
+{
+    using type = QJsonDocument;
+    static QJsonDocument convert(const QJsonArray & value) { return QJsonDocument(value); }
+};
+
+
+class SHARED Result final
+{
+    friend class Connection;
+    friend class Query;
+    friend class ArrowWriter;
+    friend class Replication;
+
+public:
+    using RangeHandler = std::function<void(int first, int last)>;
+
+    Result();
+
+    const QVector<Field> & fields() const;
+
+    int rowCount() const;
+    int columnCount() const;
+    int indexOf(const QString & name) const;
+    QVariant value(int row, int column) const;
+    QVariant value(int row, const QString & name) const;
+
+    template<typename C> C array(int row, int column) const;
+    template<typename T> QVector<T> column(int column) const;
+
+    template<typename T> QVector<T> parallelColumn(int column, QThreadPool * pool = nullptr) const;
+    QVector<QVariantList> parallelRows(QThreadPool * pool = nullptr) const;
+    void parallelRanges(const RangeHandler & handler, QThreadPool * pool = nullptr) const;
+
+    template<typename... T> QVector<std::tuple<T...>> rows(QString * error = nullptr) const;
+    template<typename S, typename... M> QVector<S> rowsAs(M S::*... members) const;
+    template<typename S, typename... M> QVector<S> rowsAs(QString * error, M S::*... members) const;
+    template<typename S, typename... M> QVector<S> rowsAs(const QStringList & columns, M S::*... members) const;
+    template<typename S, typename... M> QVector<S> rowsAs(const QStringList & columns, QString * error, M S::*... members) const;
+
+    QJsonDocument jsonDocument(int row, int column) const;
+#if QT_VERSION >= 0x060000
+    QByteArrayView json(int row, int column) const;
+    QUtf8StringView jsonText(int row, int column) const;
+    QByteArrayView bytes(int row, int column) const;
+    QUtf8StringView text(int row, int column) const;
+#else
+    QByteArray json(int row, int column) const;
+    QByteArray bytes(int row, int column) const;
+#endif
+    QString string(int row, int column) const;
+    qint64 microseconds(int row, int column) const;
+
+    qint64 writeCsv(QIODevice * device, int from = 0, char delimiter = ',') const;
+    qint64 writeJsonLines(QIODevice * device, int from = 0) const;
+
+    QString commandTag() const;
+    qint64 affectedRows() const;
+
+private:
+    struct Data;
+    QSharedPointer<Data> _d;
+
+    template<typename T> using Reader = T (*)(const char * data, qint32 size);
+    template<typename T> Reader<T> reader(int column, QString & error) const;
+
+    template<typename C> C arrayCell(int row, int column) const;
+    template<typename T> QVector<T> columnValues(int column) const;
+    template<typename T> QVector<T> parallelColumnValues(int column, QThreadPool * pool) const;
+
+    template<typename S, typename... T, std::size_t... I, typename F>
+    QVector<S> decodeRows(const QVector<int> & columns, std::index_sequence<I...>, F make, QString & error) const;
+
+    template<typename... T> QVector<std::tuple<T...>> tupleRows(QString & error) const;
+    template<typename S, typename... M> QVector<S> structRows(const QVector<int> & columns, QString & error, M S::*... members) const;
+
+    QVector<int> columnIndexes(const QStringList & columns) const;
+    static QString columnCountError(int columns, int members);
+    qint64 writeText(QIODevice * device, int from, char delimiter, bool json) const;
+    const char * rowData(int row) const;
+    const char * cell(int row, int column, qint32 & size) const;
+    void cells(int row, const char ** data, qint32 * size) const;
+    QVariant decode(int column, const char * data, qint32 size) const;
+};
+
+template<typename S, typename... T, std::size_t... I, typename F>
+QVector<S> Result::decodeRows(const QVector<int> & columns, std::index_sequence<I...>, F make, QString & error) const
+{
+    static_assert(sizeof...(T) > 0, "At least one column is required");
+    static_assert((Decodable<T>::value && ...), "Unsupported column type");
+
+    QVector<S> values;
+
+    if(!columns.isEmpty() && columns.size() != int(sizeof...(T)))
+    {
+       if(error.isEmpty()) error = columnCountError(columns.size(), int(sizeof...(T)));
+       return values;
+    }
+
+    const int index[] = {(columns.isEmpty() ? int(I) : columns[I])...};
+    const std::tuple<Reader<T>...> readers(reader<T>(index[I], error)...);
+
+    if(!((std::get<I>(readers) != nullptr) && ...)) return values;
+
+    QVarLengthArray<const char *, 32> data(columnCount());
+    QVarLengthArray<qint32, 32> size(columnCount());
+
+    values.reserve(rowCount());
+
+    for(int row = 0; row < rowCount(); row++)
+    {
+        cells(row, data.data(), size.data());
+        values.append(make((size[index[I]] < 0) ? T() : std::get<I>(readers)(data[index[I]], size[index[I]])...));
+    }
+
+    return values;
+}
+
+template<typename C> C Result::array(int row, int column) const
+{
+    static_assert(DecodableArray<C>::value, "Unsupported array container type");
+    return arrayCell<C>(row, column);
+}
+
+template<typename T> QVector<T> Result::column(int column) const
+{
+    static_assert(Decodable<T>::value, "Unsupported column type");
+    return columnValues<T>(column);
+}
+
+template<typename T> QVector<T> Result::parallelColumn(int column, QThreadPool * pool) const
+{
+    static_assert(Decodable<T>::value, "Unsupported column type");
+    return parallelColumnValues<T>(column, pool);
+}
+
+template<typename... T> QVector<std::tuple<T...>> Result::tupleRows(QString & error) const
+{
+    return decodeRows<std::tuple<T...>, T...>(QVector<int>(), std::index_sequence_for<T...>(), [](T &&... v)
+    {
+        return std::tuple<T...>(std::move(v)...);
+    }, error);
+}
+
+template<typename S, typename... M> QVector<S> Result::structRows(const QVector<int> & columns, QString & error, M S::*... members) const
+{
+    return decodeRows<S, M...>(columns, std::index_sequence_for<M...>(), [members...](M &&... v)
+    {
+        S s;
+        ((s.*members = std::move(v)), ...);
+        return s;
+    }, error);
+}
+
+template<typename... T> QVector<std::tuple<T...>> Result::rows(QString * error) const
+{
+    QString message;
+    auto values = tupleRows<T...>(message);
+
+    if(error != nullptr) *error = message;
+    return values;
+}
+
+template<typename S, typename... M> QVector<S> Result::rowsAs(M S::*... members) const
+{
+    return rowsAs<S>(nullptr, members...);
+}
+
+template<typename S, typename... M> QVector<S> Result::rowsAs(QString * error, M S::*... members) const
+{
+    QString message;
+    auto values = structRows<S>(QVector<int>(), message, members...);
+
+    if(error != nullptr) *error = message;
+    return values;
+}
+
+template<typename S, typename... M> QVector<S> Result::rowsAs(const QStringList & columns, M S::*... members) const
+{
+    return rowsAs<S>(columns, nullptr, members...);
+}
+
+template<typename S, typename... M> QVector<S> Result::rowsAs(const QStringList & columns, QString * error, M S::*... members) const
+{
+    QString message;
+    auto values = structRows<S>(columnIndexes(columns), message, members...);
+
+    if(error != nullptr) *error = message;
+    return values;
+}
+
+
+static constexpr char CaptureMagic[] = "TinyPGC1";
+constexpr char CaptureRead = 0x3C, CaptureWrite = 0x3E;
+constexpr int CaptureFrameSize = 13;
 
 class Query;
+class Replication;
 class SHARED Connection final: public QObject
 {
     Q_OBJECT
 
     friend class Query;
+    friend class Replication;
 
 public:
     explicit Connection(QObject * parent = nullptr);
@@ -79,19 +413,70 @@ public:
                     const QString & user = "postgres",
                     const QString & password = "postgres",
                     const QString & database = QString());
+    void connection(QIODevice * device,
+                    const QString & user = "postgres",
+                    const QString & password = "postgres",
+                    const QString & database = QString());
+
+    void registerType(quint32 oid, const Codec & codec);
+    void registerType(const QString & name, const Codec & codec);
+
+    qint64 memoryUsage() const;
+    qint64 memoryPeak() const;
+    void setMemoryLimits(qint64 soft, qint64 hard);
+
+    QIODevice * capture() const;
+    void setCapture(QIODevice * device);
+
+    bool isPaused() const;
+    void pause();
+    void resume();
 
 public slots:
     void close();
+    void cancel();
 
 private:
     QByteArray _bufferIn, _bufferOut;
     QTcpSocket _socket;
+    QIODevice * _device = &_socket;
 
     QByteArray _user, _password, _database;
     QMap<QString, QString> _parametersStatus;
 
     quint32 _pid = 0, _key = 0;
-    bool _auth_success = false;
+    bool _auth_success = false, _ready = false;
+
+    QHash<quint32, QSharedPointer<const Codec>> _codecs, _oidCodecs;
+    QMap<QString, QSharedPointer<const Codec>> _namedCodecs;
+
+    Query * _typesQuery = nullptr;
+    Query * _drainQuery = nullptr;
+    bool _typesStale = false;
+
+    QHash<QByteArray, Result> _descriptions;
+
+    Replication * _replication = nullptr;
+    bool _paused = false;
+
+    QByteArray _streamRow;
+    qint64 _streamLeft = 0, _skipLeft = 0;
+    qint32 _streamCell = -1;
+    int _streamColumn = -1;
+
+    qint64 _memoryUsed = 0, _memoryPeak = 0, _memorySoft = 0, _memoryHard = 0;
+    bool _memoryWarned = false;
+
+    void account(qint64 delta);
+
+    QPointer<QIODevice> _capture;
+    QElapsedTimer _captureClock;
+    bool _capturing = false;
+
+    void startCapture();
+    void record(char direction, const char * data, qint64 size);
+    qint64 send(const char * data, qint64 size);
+    qint64 send(const QByteArray & data);
 
     enum class ErrorOrNotice
     {
@@ -104,18 +489,33 @@ private:
     void parameterStatus(const char * data);
     void backendKeyData(const char * data);
     void readyForQuery(const char * data);
-    void rowDescription(const char * data);
+    void rowDescription(const char * data, quint32 size);
+    void describeField(Field & field) const;
     void preparedParametrs(const char * data, quint32 size);
     void dataRow(const char * data, quint32 size);
+    void commandCompletion(const char * data, quint32 size);
+    qint64 streamRow(const char * data, qint64 size);
     void runQuery(Query * query);
+    void runScript(Query * query);
     void runPrepareQuery(Query * query);
     void runBindQuery(Query * query);
+    void appendPortalExecute(QByteArray & out, Query * query);
+    void fetchPortal(Query * query);
+    void closePortal(Query * query);
+    void discardPortal(Query * query);
+    void removeQuery(Query * query);
+    void portalSuspended();
 
     QQueue<Query *> _tasks;
+    int _pendingSyncs = 0;
     void taskFromQueue();
     void endTask();
+    void failTask(const Message & e);
     void addQuery(Query * query);
 
+    void resolveTypes();
+    void typesFinished();
+
 private slots:
     void makeStarupMessage();
     void analyzePacket();
@@ -123,6 +523,8 @@ private slots:
 signals:
     void connected();
     void disconnected();
+    void typesResolved();
+    void memoryWarning(qint64 bytes);
 
     void error(const Message & error);
     void notice(const Message & notice);
@@ -134,11 +536,14 @@ class SHARED Query final: public QObject
     Q_OBJECT
 
     friend class Connection;
+    friend class ArrowWriter;
     friend QDebug operator << (QDebug debug, const Query & query);
     static quint64 _stmt_number;
 
 public:
 
+    using StreamHandler = std::function<void(int row, const char * data, qint64 size)>;
+
     explicit Query(Connection * db, QObject * parent = nullptr);
     ~Query();
 
@@ -146,37 +551,121 @@ public:
 
     void exec();
     void exec(const QString & query);
+    void execScript(const QString & script);
     void prepare(const QString & query);
 
     const QVector<QVariant> & bindValues() const;
     void bindValue(int index, const std::variant<qint16,qint32,QVariant> & value);
+    void bindEncoded(int index, const QByteArray & data);
+
+    template<typename T> void bind(int index, const T & value);
+    template<typename... T> void execWith(const T &... values);
 
     const QVector<Field> & fields() const;
 
+    void setStream(int column, QIODevice * device);
+    void setStream(int column, const StreamHandler & handler);
+    void clearStreams();
+
     int rowCount() const;
     int columnCount() const;
+
+    int fetchSize() const;
+    void setFetchSize(int rows);
+    bool canFetchMore() const;
+    void fetchMore();
+    void closePortal();
+
+    qint64 spillThreshold() const;
+    void setSpillThreshold(qint64 bytes);
+
+    qint64 memoryUsage() const;
+    qint64 memoryPeak() const;
+    void setMemoryLimits(qint64 soft, qint64 hard);
+
+    Result takeResult();
+    QVector<Result> results();
+
+    QString commandTag() const;
+    qint64 affectedRows() const;
+
+    int indexOf(const QString & name) const;
     QVariant value(int row, int column) const;
+    QVariant value(int row, const QString & name) const;
+
+    template<typename C> C array(int row, int column) const;
+    template<typename T> QVector<T> column(int column) const;
+
+    template<typename T> QVector<T> parallelColumn(int column, QThreadPool * pool = nullptr) const;
+    QVector<QVariantList> parallelRows(QThreadPool * pool = nullptr) const;
+    void parallelRanges(const Result::RangeHandler & handler, QThreadPool * pool = nullptr) const;
+
+    template<typename... T> QVector<std::tuple<T...>> rows() const;
+    template<typename S, typename... M> QVector<S> rowsAs(M S::*... members) const;
+    template<typename S, typename... M> QVector<S> rowsAs(const QStringList & columns, M S::*... members) const;
+
+    QJsonDocument jsonDocument(int row, int column) const;
+#if QT_VERSION >= 0x060000
+    QByteArrayView json(int row, int column) const;
+    QUtf8StringView jsonText(int row, int column) const;
+    QByteArrayView bytes(int row, int column) const;
+    QUtf8StringView text(int row, int column) const;
+#else
+    QByteArray json(int row, int column) const;
+    QByteArray bytes(int row, int column) const;
+#endif
+    QString string(int row, int column) const;
+    qint64 microseconds(int row, int column) const;
+
+    qint64 writeCsv(QIODevice * device, int from = 0, char delimiter = ',') const;
+    qint64 writeJsonLines(QIODevice * device, int from = 0) const;
 
 signals:
     void executeFinished();
     void prepareFinished();
+    void memoryWarning(qint64 bytes);
 
     void error(const Message & error);
     void notice(const Message & notice);
 
 private:
-    Connection * _db = nullptr;
-    bool _prepare = false, _prepareFinished = false;
+    QPointer<Connection> _db;
+    bool _prepare = false, _prepareFinished = false, _aborted = false;
+    bool _script = false, _statementDone = false, _resultShared = false;
 
     QByteArray _stmtName;
     QString _lastQuery;
 
-    QVector<Field> _fields;
+    Result _result;
+    QVector<Result> _results;
     QVector<quint32> _preparedParametrs;
+    QVector<QSharedPointer<const Codec>> _parameterCodecs;
 
     QVector<QVariant> _bindValues;
-    QVector<char *> _dataRows;
-
+    QHash<int, StreamHandler> _streams;
+    QVector<QByteArray> _parameterData;
+    QVector<quint8> _parameterState;
+    QVector<int> _parameterOffsets;
+    QByteArray _bindTemplate;
+
+    qint64 _spillThreshold = 0, _memoryUsed = 0, _memoryPeak = 0, _memorySoft = 0, _memoryHard = 0;
+    bool _memoryWarned = false;
+
+    int _fetchSize = 0;
+    quint8 _portal = 0;
+
+    void report(const QString & message) const;
+    bool bindIndex(int index);
+    bool unbind(int index, const QString & message);
+    template<typename T> bool bindParameter(int index, const T & value);
+    template<typename T> bool bindTyped(int index, const T & value);
+    bool exceeds(qint64 size) const;
+    void abort(const QString & message);
+    void clearRows();
+    void clear();
+    void resetResults();
+    void detachShared();
+    void startStatement();
     void preparation(const QString & query);
     void addPreparedParametr(quint32 oid);
     void addDataRow(const char * data, quint32 size);
@@ -184,6 +673,345 @@ private:
 
 QDebug operator << (QDebug debug, const Query & query);
 
+template<typename T> bool Query::bindParameter(int index, const T & value)
+{
+    using B = Bindable<std::decay_t<T>>;
+    static_assert(!std::is_void<typename B::type>::value, "Unsupported parameter type");
+
+    return bindTyped<typename B::type>(index, B::convert(value));
+}
+
+template<typename T> void Query::bind(int index, const T & value)
+{
+    bindParameter(index, value);
+}
+
+template<typename... T> void Query::execWith(const T &... values)
+{
+    int index = 0;
+    if((bindParameter(index++, values) && ...)) exec();
+}
+
+template<typename C> C Query::array(int row, int column) const
+{
+    return _result.array<C>(row, column);
+}
+
+template<typename T> QVector<T> Query::column(int column) const
+{
+    return _result.column<T>(column);
+}
+
+template<typename T> QVector<T> Query::parallelColumn(int column, QThreadPool * pool) const
+{
+    return _result.parallelColumn<T>(column, pool);
+}
+
+template<typename... T> QVector<std::tuple<T...>> Query::rows() const
+{
+    QString error;
+    auto values = _result.tupleRows<T...>(error);
+
+    if(!error.isEmpty()) report(error);
+    return values;
+}
+
+template<typename S, typename... M> QVector<S> Query::rowsAs(M S::*... members) const
+{
+    QString error;
+    auto values = _result.structRows<S>(QVector<int>(), error, members...);
+
+    if(!error.isEmpty()) report(error);
+    return values;
+}
+
+template<typename S, typename... M> QVector<S> Query::rowsAs(const QStringList & columns, M S::*... members) const
+{
+    QString error;
+    auto values = _result.structRows<S>(_result.columnIndexes(columns), error, members...);
+
+    if(!error.isEmpty()) report(error);
+    return values;
+}
+
+
+class SHARED QueryModel final: public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit QueryModel(Query * query, QObject * parent = nullptr);
+
+    Query * query() const;
+
+    int rowCount(const QModelIndex & parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex & parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    bool canFetchMore(const QModelIndex & parent) const override;
+    void fetchMore(const QModelIndex & parent) override;
+
+private slots:
+    void executeFinished();
+
+private:
+    QPointer<Query> _query;
+    int _rows = 0, _columns = 0;
+    bool _fetching = false;
+};
+
+
+class SHARED ArrowWriter final
+{
+public:
+    enum Format
+    {
+         Stream,
+         File
+    };
+
+    explicit ArrowWriter(QIODevice * device, Format format = Stream);
+    ~ArrowWriter();
+
+    bool write(const Result & result, int from = 0);
+    bool write(const Query & query, int from = 0);
+    bool close();
+
+    const QString & errorString() const;
+
+private:
+    struct Block
+    {
+        qint64 offset, metadata, body;
+    };
+
+    QIODevice * _device;
+    Format _format;
+    QVector<Field> _fields;
+    QVector<Block> _blocks;
+    QString _error;
+
+    qint64 _position = 0;
+    bool _started = false, _closed = false;
+
+    bool start(const QVector<Field> & fields);
+    bool writeMessage(const QByteArray & metadata, const QByteArray & body, bool batch);
+    bool put(const QByteArray & data);
+};
+
+
+class SHARED Host final
+{
+    friend class Cluster;
+    friend QDebug operator << (QDebug debug, const Host & host);
+
+    QHostAddress _address;
+    quint16 _port = 5432;
+
+    Connection * _db = nullptr;
+    Query * _probe = nullptr;
+    QElapsedTimer _probeTimer;
+
+    double _latency = -1;
+    bool _connecting = false, _healthy = false, _readOnly = false, _probing = false, _probeFailed = false;
+
+public:
+    const QHostAddress & address() const;
+    quint16 port() const;
+    Connection * connection() const;
+
+    bool isHealthy() const;
+    bool isReadOnly() const;
+    double latency() const;
+};
+
+QDebug operator << (QDebug debug, const Host & host);
+
+
+class SHARED Cluster final: public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class TargetSessionAttrs
+    {
+        Any,
+        ReadWrite,
+        ReadOnly,
+        PreferStandby
+    };
+
+    explicit Cluster(QObject * parent = nullptr);
+    ~Cluster();
+
+    bool isConnect() const;
+    void connection(const QVector<QPair<QHostAddress, quint16>> & hosts,
+                    const QString & user = "postgres",
+                    const QString & password = "postgres",
+                    const QString & database = QString(),
+                    TargetSessionAttrs target = TargetSessionAttrs::ReadWrite);
+
+    Connection * session(TargetSessionAttrs attrs = TargetSessionAttrs::Any) const;
+    Connection * writer() const;
+    Connection * reader() const;
+
+    const QVector<Host> & hosts() const;
+
+    int probeInterval() const;
+    void setProbeInterval(int msec);
+
+public slots:
+    void close();
+
+signals:
+    void connected();
+    void disconnected();
+    void hostChanged(int index);
+
+    void error(const Message & error);
+
+private:
+    QVector<Host> _hosts;
+    QTimer _timer;
+
+    QString _user, _password, _database;
+    TargetSessionAttrs _target = TargetSessionAttrs::ReadWrite;
+    bool _connected = false;
+
+    void clear();
+    void connectHost(int index);
+    void probe(int index);
+    void probeFinished(int index);
+    void hostLost(int index);
+    void updateState();
+
+private slots:
+    void heartbeat();
+};
+
+
+
+class SHARED Relation final
+{
+    friend class Replication;
+    friend QDebug operator << (QDebug debug, const Relation & relation);
+
+    quint32 _oid = 0;
+    QString _schema, _name;
+    char _identity = 0;
+    Result _description;
+    QVector<bool> _keys;
+
+public:
+    quint32 oid() const;
+    const QString & schema() const;
+    const QString & name() const;
+    char replicaIdentity() const;
+
+    const QVector<Field> & fields() const;
+    bool isKey(int column) const;
+};
+
+QDebug operator << (QDebug debug, const Relation & relation);
+
+
+class SHARED Change final
+{
+    friend class Replication;
+
+public:
+    enum class Type
+    {
+        Insert,
+        Update,
+        Delete,
+        Truncate
+    };
+
+    Type type() const;
+    quint32 xid() const;
+    quint64 lsn() const;
+    const Relation & relation() const;
+
+    const QVariantList & values() const;
+    const QVariantList & oldValues() const;
+    bool isUnchanged(int column) const;
+
+private:
+    Type _type = Type::Insert;
+    quint32 _xid = 0;
+    quint64 _lsn = 0;
+    Relation _relation;
+    QVariantList _values, _oldValues;
+    QVector<bool> _unchanged;
+};
+
+
+class SHARED Replication final: public QObject
+{
+    Q_OBJECT
+
+    friend class Connection;
+
+public:
+    explicit Replication(Connection * db, QObject * parent = nullptr);
+    ~Replication();
+
+    bool isActive() const;
+    void start(const QString & slot, const QStringList & publications, quint64 lsn = 0);
+    void stop();
+
+    quint64 receivedLsn() const;
+    quint64 acknowledgedLsn() const;
+    void acknowledge(quint64 lsn);
+
+    bool autoAcknowledge() const;
+    void setAutoAcknowledge(bool enable);
+
+    int statusInterval() const;
+    void setStatusInterval(int msec);
+
+    static QString lsnToString(quint64 lsn);
+    static quint64 lsnFromString(const QString & lsn, bool * ok = nullptr);
+
+signals:
+    void started();
+    void stopped();
+
+    void relation(const TinyPG::Relation & relation);
+    void begin(quint32 xid, quint64 lsn, const QDateTime & time);
+    void change(const TinyPG::Change & change);
+    void commit(quint32 xid, quint64 lsn, const QDateTime & time);
+
+    void error(const Message & error);
+
+private:
+    QPointer<Connection> _db;
+    QTimer _timer;
+
+    QHash<quint32, Relation> _relations;
+    quint32 _xid = 0;
+    quint64 _received = 0, _flushed = 0;
+    bool _starting = false, _active = false, _stopping = false, _transaction = false, _auto = true;
+
+    void copyBoth();
+    void copyData(const char * data, quint32 size);
+    void copyDone();
+
+    void logical(const char * data, const char * end, quint64 lsn);
+    bool relationMessage(const char * data, const char * end);
+    bool tuple(const Relation & relation, const char *& data, const char * end, QVariantList & values, QVector<bool> * unchanged) const;
+    void sendStatus();
+    void reset();
+    void fail(const QString & message);
+};
+
 }
 
+Q_DECLARE_METATYPE(TinyPG::Numeric)
+Q_DECLARE_METATYPE(TinyPG::Result)
+Q_DECLARE_METATYPE(TinyPG::Relation)
+Q_DECLARE_METATYPE(TinyPG::Change)
+
 #endif
@@ -0,0 +1,622 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QScopeGuard>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+#include <QtEndian>
+#include "TinyPG.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#define PointSql "select id, v, txt, ts from tinypg_bench where id = $1"
+#define ScanSql "select id, v, txt, ts from tinypg_bench limit $1"
+#define InsertSql "insert into tinypg_bench_insert (v, txt, ts) values ($1, $2, $3)"
+
+#define SSLRequestCode 80877103
+#define CancelRequestCode 80877102
+
+enum Kind
+{
+    PointKind,
+    ScanKind,
+    InsertKind,
+    KindCount
+};
+
+static const char * const kindNames[KindCount] = {"point", "scan", "insert"};
+
+struct Options
+{
+    QString workload;
+    int connections = 1, concurrency = 1, scanRows = 1000, tableRows = 100000;
+    double duration = 10, warmup = 1, writeRatio = 0.2;
+    bool decode = false;
+};
+
+//Mock====================================================================================================
+//========================================================================================================
+
+class MockServer final : public QTcpServer
+{
+public:
+    explicit MockServer(const Options & options);
+
+protected:
+    void incomingConnection(qintptr descriptor) override;
+
+private:
+    struct Canned
+    {
+        QByteArray parameters, description, execute;
+    };
+
+    struct Session
+    {
+        QByteArray in;
+        bool started = false;
+        QHash<QByteArray, int> statements;
+        int portal = 0;
+    };
+
+    QByteArray _greeting, _ready;
+    QVector<Canned> _canned;
+    QHash<QByteArray, int> _lookup;
+
+    void serve(QTcpSocket * socket, Session & session);
+};
+
+static void appendMessage(QByteArray & out, char type, const QByteArray & body = QByteArray())
+{
+    const quint32 size = qToBigEndian(quint32(sizeof (quint32) + body.size()));
+
+    out.append(type);
+    out.append(reinterpret_cast<const char *>(&size), sizeof (size));
+    out.append(body);
+}
+
+template<typename T> static void appendBig(QByteArray & out, T value)
+{
+    value = qToBigEndian(value);
+    out.append(reinterpret_cast<const char *>(&value), sizeof (T));
+}
+
+static QByteArray benchDescription()
+{
+    const struct { const char * name; quint32 oid; qint16 size; } columns[] = {{"id", 20, 8}, {"v", 23, 4}, {"txt", 25, -1}, {"ts", 1184, 8}};
+
+    QByteArray body;
+    appendBig<qint16>(body, 4);
+
+    for(const auto & column : columns)
+    {
+        body.append(column.name);
+        body.append(char(0));
+        appendBig<quint32>(body, 0);
+        appendBig<qint16>(body, 0);
+        appendBig<quint32>(body, column.oid);
+        appendBig<qint16>(body, column.size);
+        appendBig<qint32>(body, -1);
+        appendBig<qint16>(body, 1);
+    }
+
+    QByteArray out;
+    appendMessage(out, 'T', body);
+    return out;
+}
+
+static QByteArray benchRows(int rows)
+{
+    QByteArray out, body;
+    const QByteArray text(32, 'x');
+
+    for(int r = 1; r <= rows; r++)
+    {
+        body.truncate(0);
+        appendBig<qint16>(body, 4);
+        appendBig<qint32>(body, 8);
+        appendBig<qint64>(body, r);
+        appendBig<qint32>(body, 4);
+        appendBig<qint32>(body, r % 1000);
+        appendBig<qint32>(body, text.size());
+        body.append(text);
+        appendBig<qint32>(body, 8);
+        appendBig<qint64>(body, 770000000000000 + r);
+        appendMessage(out, 'D', body);
+    }
+
+    appendMessage(out, 'C', "SELECT " + QByteArray::number(rows) + '\0');
+    return out;
+}
+
+static QByteArray parameters(const QVector<quint32> & oids)
+{
+    QByteArray body, out;
+    appendBig<qint16>(body, oids.size());
+    for(quint32 oid : oids) appendBig<quint32>(body, oid);
+    appendMessage(out, 't', body);
+    return out;
+}
+
+MockServer::MockServer(const Options & options)
+{
+    QByteArray body;
+
+    appendBig<quint32>(body, 0);
+    appendMessage(_greeting, 'R', body);
+    appendMessage(_greeting, 'S', QByteArray("server_version\0" "16.0\0", 20));
+    appendMessage(_greeting, 'S', QByteArray("client_encoding\0" "UTF8\0", 21));
+    body.truncate(0);
+    appendBig<quint32>(body, 1);
+    appendBig<quint32>(body, 2);
+    appendMessage(_greeting, 'K', body);
+    appendMessage(_ready, 'Z', "I");
+    _greeting.append(_ready);
+
+    QByteArray none, complete;
+    appendMessage(none, 'n');
+    appendMessage(complete, 'C', QByteArray("SELECT 0\0", 9));
+    _canned.append({parameters({}), none, complete});
+
+    const QByteArray description = benchDescription();
+
+    _lookup.insert(PointSql, _canned.size());
+    _canned.append({parameters({20}), description, benchRows(1)});
+
+    _lookup.insert(ScanSql, _canned.size());
+    _canned.append({parameters({20}), description, benchRows(options.scanRows)});
+
+    complete.clear();
+    appendMessage(complete, 'C', QByteArray("INSERT 0 1\0", 11));
+    _lookup.insert(InsertSql, _canned.size());
+    _canned.append({parameters({23, 25, 1184}), none, complete});
+}
+
+void MockServer::incomingConnection(qintptr descriptor)
+{
+    QTcpSocket * socket = new QTcpSocket(this);
+
+    if(!socket->setSocketDescriptor(descriptor))
+    {
+       delete socket;
+       return;
+    }
+
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    auto session = std::make_shared<Session>();
+    connect(socket, &QTcpSocket::readyRead, socket, [this, socket, session]() { serve(socket, *session); });
+    connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+}
+
+void MockServer::serve(QTcpSocket * socket, Session & session)
+{
+    session.in.append(socket->readAll());
+
+    const char * in = session.in.constData();
+    const qsizetype size = session.in.size();
+    qsizetype pos = 0;
+    QByteArray out;
+
+    while(true)
+    {
+        if(!session.started)
+        {
+           if(size - pos < 8) break;
+
+           const quint32 length = qFromBigEndian<quint32>(in + pos);
+           const quint32 code = qFromBigEndian<quint32>(in + pos + sizeof (quint32));
+
+           if(size - pos < length) break;
+           pos += length;
+
+           if(code == SSLRequestCode)
+           {
+              out.append('N');
+              continue;
+           }
+
+           if(code == CancelRequestCode)
+           {
+              socket->disconnectFromHost();
+              return;
+           }
+
+           session.started = true;
+           out.append(_greeting);
+           continue;
+        }
+
+        if(size - pos < 5) break;
+
+        const char type = in[pos];
+        const quint32 length = qFromBigEndian<quint32>(in + pos + 1);
+
+        if(size - pos < qsizetype(length) + 1) break;
+
+        const char * body = in + pos + 5;
+        pos += length + 1;
+
+        switch(type)
+        {
+            case 'P':
+            {
+                const QByteArray name(body);
+                session.statements.insert(name, _lookup.value(QByteArray(body + name.size() + 1), 0));
+                appendMessage(out, '1');
+            }
+            break;
+            case 'B':
+            {
+                const qsizetype portal = std::strlen(body);
+                session.portal = session.statements.value(QByteArray(body + portal + 1), 0);
+                appendMessage(out, '2');
+            }
+            break;
+            case 'D':
+            {
+                if(body[0] == 'S')
+                {
+                   const Canned & canned = _canned[session.statements.value(QByteArray(body + 1), 0)];
+                   out.append(canned.parameters);
+                   out.append(canned.description);
+                }
+                else out.append(_canned[session.portal].description);
+            }
+            break;
+            case 'E': out.append(_canned[session.portal].execute);
+            break;
+            case 'C': appendMessage(out, '3');
+            break;
+            case 'S': out.append(_ready);
+            break;
+            case 'Q':
+            {
+                out.append(_canned[0].execute);
+                out.append(_ready);
+            }
+            break;
+            case 'X':
+            {
+                socket->disconnectFromHost();
+                return;
+            }
+        }
+    }
+
+    session.in.remove(0, pos);
+    if(!out.isEmpty()) socket->write(out);
+}
+
+//Bench===================================================================================================
+//========================================================================================================
+
+struct Recorder
+{
+    QVector<qint64> latencies[KindCount];
+    qint64 errors = 0;
+    bool running = true, recording = false;
+    int active = 0;
+    QEventLoop * loop = nullptr;
+};
+
+class Worker
+{
+public:
+    Worker(TinyPG::Connection * db, Recorder * recorder, const Options & options);
+
+    QVector<QPair<TinyPG::Query *, QString>> statements();
+    void next();
+
+private:
+    TinyPG::Connection * _db;
+    TinyPG::Query _point, _scan, _insert;
+    Recorder * _recorder;
+    const Options & _options;
+    QElapsedTimer _timer;
+    Kind _kind = PointKind;
+    const QString _text;
+    bool _failed = false, _starting = false;
+
+    void finished();
+};
+
+Worker::Worker(TinyPG::Connection * db, Recorder * recorder, const Options & options) : _db(db), _point(db), _scan(db), _insert(db),
+    _recorder(recorder), _options(options), _text(32, QLatin1Char('x'))
+{
+    for(TinyPG::Query * query : {&_point, &_scan, &_insert})
+    {
+        query->connect(query, &TinyPG::Query::executeFinished, [this]() { finished(); });
+        query->connect(query, &TinyPG::Query::error, [this](const TinyPG::Message & error)
+        {
+            if(_recorder->errors++ == 0) std::fprintf(stderr, "%s\n", qPrintable(error.message()));
+            _failed = true;
+
+            if(_starting || !_db->isConnect()) QTimer::singleShot(0, &_point, [this]() { finished(); });
+        });
+    }
+}
+
+QVector<QPair<TinyPG::Query *, QString>> Worker::statements()
+{
+    const QString & workload = _options.workload;
+    QVector<QPair<TinyPG::Query *, QString>> statements;
+
+    if(workload == "point" || workload == "mixed") statements.append({&_point, PointSql});
+    if(workload == "scan") statements.append({&_scan, ScanSql});
+    if(workload == "insert" || workload == "mixed") statements.append({&_insert, InsertSql});
+
+    return statements;
+}
+
+void Worker::next()
+{
+    if(!_recorder->running)
+    {
+       if(--_recorder->active == 0) _recorder->loop->quit();
+       return;
+    }
+
+    QRandomGenerator * random = QRandomGenerator::global();
+    const QString & workload = _options.workload;
+
+    if(workload == "mixed") _kind = (random->generateDouble() < _options.writeRatio) ? InsertKind : PointKind;
+    else if(workload == "scan") _kind = ScanKind;
+    else if(workload == "insert") _kind = InsertKind;
+    else _kind = PointKind;
+
+    _failed = false;
+    _starting = true;
+    _timer.start();
+
+    switch(_kind)
+    {
+        case PointKind: _point.execWith(qint64(random->bounded(_options.tableRows) + 1));
+        break;
+        case ScanKind: _scan.execWith(qint64(_options.scanRows));
+        break;
+        default: _insert.execWith(qint32(random->bounded(1000)), _text, QDateTime::currentDateTimeUtc());
+    }
+
+    _starting = false;
+}
+
+void Worker::finished()
+{
+    const qint64 nsecs = _timer.nsecsElapsed();
+    const bool failed = _failed;
+
+    if(!failed && _kind == ScanKind && _options.decode)
+    {
+       for(int r = 0; r < _scan.rowCount(); r++)
+           for(int c = 0; c < _scan.columnCount(); c++) _scan.value(r, c);
+    }
+
+    if(!failed && _recorder->recording) _recorder->latencies[_kind].append(nsecs);
+    next();
+}
+
+static qint64 percentile(const QVector<qint64> & sorted, double p)
+{
+    if(sorted.isEmpty()) return 0;
+    const qsizetype index = qBound<qsizetype>(0, qsizetype(std::ceil(p * sorted.size())) - 1, sorted.size() - 1);
+    return sorted[index];
+}
+
+static void report(const char * name, QVector<qint64> latencies, double seconds)
+{
+    std::sort(latencies.begin(), latencies.end());
+
+    std::printf("%-8s %10lld %12.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", name, qint64(latencies.size()), latencies.size() / seconds,
+                percentile(latencies, 0.5) / 1e3, percentile(latencies, 0.9) / 1e3, percentile(latencies, 0.99) / 1e3,
+                percentile(latencies, 0.999) / 1e3, latencies.isEmpty() ? 0.0 : latencies.last() / 1e3);
+}
+
+static bool waitFor(QEventLoop & loop, TinyPG::Query * query, void (TinyPG::Query::*signal)(), const std::function<void()> & start)
+{
+    bool failed = false;
+    auto done = QObject::connect(query, signal, &loop, &QEventLoop::quit);
+    auto failure = QObject::connect(query, &TinyPG::Query::error, &loop, [&](const TinyPG::Message & error)
+    {
+        std::fprintf(stderr, "%s\n", qPrintable(error.message()));
+        failed = true;
+        loop.quit();
+    });
+
+    start();
+    loop.exec();
+
+    QObject::disconnect(done);
+    QObject::disconnect(failure);
+    return !failed;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("TinyPG end-to-end load generator");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"host", "PostgreSQL host address.", "address", "127.0.0.1"},
+        {"port", "PostgreSQL port.", "port", "5432"},
+        {"user", "User name.", "name", "postgres"},
+        {"password", "Password.", "password", "postgres"},
+        {"database", "Database name.", "name", "postgres"},
+        {"mock", "Run against an in-process mock backend instead of PostgreSQL."},
+        {"workload", "One of point, insert, scan, mixed.", "name", "point"},
+        {"connections", "Number of connections.", "count", "4"},
+        {"concurrency", "Queries in flight per connection.", "count", "1"},
+        {"duration", "Measured seconds.", "seconds", "10"},
+        {"warmup", "Unmeasured seconds before the run.", "seconds", "1"},
+        {"scan-rows", "Rows returned by each scan.", "count", "1000"},
+        {"table-rows", "Rows in the point select table.", "count", "100000"},
+        {"write-ratio", "Share of inserts in the mixed workload.", "ratio", "0.2"},
+        {"decode", "Decode every cell of scan results through Query::value."},
+        {"skip-setup", "Do not create and fill the benchmark tables."},
+    });
+    parser.process(a);
+
+    Options options;
+    options.workload = parser.value("workload");
+    options.connections = qMax(1, parser.value("connections").toInt());
+    options.concurrency = qMax(1, parser.value("concurrency").toInt());
+    options.duration = qMax(0.1, parser.value("duration").toDouble());
+    options.warmup = qMax(0.0, parser.value("warmup").toDouble());
+    options.scanRows = qMax(1, parser.value("scan-rows").toInt());
+    options.tableRows = qMax(1, parser.value("table-rows").toInt());
+    options.writeRatio = qBound(0.0, parser.value("write-ratio").toDouble(), 1.0);
+    options.decode = parser.isSet("decode");
+
+    if(!QStringList({"point", "insert", "scan", "mixed"}).contains(options.workload))
+    {
+        std::fprintf(stderr, "Unknown workload: %s\n", qPrintable(options.workload));
+        return 1;
+    }
+
+    QHostAddress host(parser.value("host"));
+    quint16 port = parser.value("port").toUShort();
+
+    QThread mockThread;
+    MockServer * mock = nullptr;
+
+    auto stopMock = qScopeGuard([&]()
+    {
+        if(mock == nullptr) return;
+
+        mockThread.quit();
+        mockThread.wait();
+        delete mock;
+    });
+
+    if(parser.isSet("mock"))
+    {
+        mock = new MockServer(options);
+        mock->moveToThread(&mockThread);
+        mockThread.start();
+
+        bool listening = false;
+        QMetaObject::invokeMethod(mock, [mock, &listening]() { listening = mock->listen(QHostAddress::LocalHost); }, Qt::BlockingQueuedConnection);
+
+        if(!listening)
+        {
+            std::fprintf(stderr, "Mock server: %s\n", qPrintable(mock->errorString()));
+            return 1;
+        }
+
+        host = QHostAddress::LocalHost;
+        port = mock->serverPort();
+    }
+
+    QEventLoop loop;
+    std::vector<std::unique_ptr<TinyPG::Connection>> connections;
+    int pending = options.connections;
+    bool failed = false;
+
+    for(int i = 0; i < options.connections; i++)
+    {
+        auto db = std::make_unique<TinyPG::Connection>();
+        db->connect(db.get(), &TinyPG::Connection::connected, &loop, [&]() { if(--pending == 0) loop.quit(); });
+        db->connect(db.get(), &TinyPG::Connection::error, &loop, [&](const TinyPG::Message & error)
+        {
+            std::fprintf(stderr, "%s\n", qPrintable(error.message()));
+            failed = true;
+            loop.quit();
+        });
+        db->connection(host, port, parser.value("user"), parser.value("password"), parser.value("database"));
+        connections.push_back(std::move(db));
+    }
+
+    loop.exec();
+    if(failed) return 1;
+
+    for(const auto & db : connections) db->disconnect(&loop);
+
+    if(!parser.isSet("skip-setup"))
+    {
+        TinyPG::Query setup(connections.front().get());
+        const QStringList statements =
+        {
+            "create table if not exists tinypg_bench (id int8 primary key, v int4 not null, txt text not null, ts timestamptz not null)",
+            "insert into tinypg_bench select g, g % 1000, md5(g::text), now() from pg_catalog.generate_series(1, " +
+                QString::number(options.tableRows) + ") g on conflict (id) do nothing",
+            "create unlogged table if not exists tinypg_bench_insert (v int4, txt text, ts timestamptz)"
+        };
+
+        for(const QString & statement : statements)
+        {
+            if(!waitFor(loop, &setup, &TinyPG::Query::executeFinished, [&]() { setup.exec(statement); })) return 1;
+        }
+    }
+
+    Recorder recorder;
+    recorder.loop = &loop;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    for(const auto & db : connections)
+    {
+        for(int i = 0; i < options.concurrency; i++)
+        {
+            workers.push_back(std::make_unique<Worker>(db.get(), &recorder, options));
+
+            for(const auto & statement : workers.back()->statements())
+            {
+                TinyPG::Query * query = statement.first;
+                if(!waitFor(loop, query, &TinyPG::Query::prepareFinished, [&]() { query->prepare(statement.second); })) return 1;
+            }
+        }
+    }
+
+    std::printf("server=%s workload=%s connections=%d concurrency=%d duration=%.1fs warmup=%.1fs\n",
+                mock ? "mock" : qPrintable(host.toString() + ':' + QString::number(port)), qPrintable(options.workload),
+                options.connections, options.concurrency, options.duration, options.warmup);
+
+    QElapsedTimer wall;
+    double seconds = 0;
+
+    QTimer::singleShot(int(options.warmup * 1000), &loop, [&]()
+    {
+        recorder.recording = true;
+        wall.start();
+    });
+
+    QTimer::singleShot(int((options.warmup + options.duration) * 1000), &loop, [&]()
+    {
+        seconds = wall.nsecsElapsed() / 1e9;
+        recorder.recording = false;
+        recorder.running = false;
+    });
+
+    recorder.active = int(workers.size());
+    for(const auto & worker : workers) worker->next();
+    loop.exec();
+
+    QVector<qint64> all;
+
+    std::printf("%-8s %10s %12s %10s %10s %10s %10s %10s\n", "kind", "ops", "ops/s", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+
+    for(int kind = 0; kind < KindCount; kind++)
+    {
+        if(recorder.latencies[kind].isEmpty()) continue;
+        report(kindNames[kind], recorder.latencies[kind], seconds);
+        all.append(recorder.latencies[kind]);
+    }
+
+    report("total", all, seconds);
+    std::printf("errors=%lld\n", recorder.errors);
+
+    workers.clear();
+    connections.clear();
+
+    return recorder.errors > 0 ? 2 : 0;
+}
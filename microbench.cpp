@@ -0,0 +1,606 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QtEndian>
+#include <QUuid>
+#include "TinyPG.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+//Allocations=============================================================================================
+//========================================================================================================
+
+static std::atomic<quint64> allocations{0};
+
+#if defined(__GLIBC__)
+#define AllocationCounting 1
+
+extern "C" void * __libc_malloc(size_t size);
+extern "C" void * __libc_calloc(size_t count, size_t size);
+extern "C" void * __libc_realloc(void * ptr, size_t size);
+
+extern "C" void * malloc(size_t size) noexcept
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void * calloc(size_t count, size_t size) noexcept
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void * realloc(void * ptr, size_t size) noexcept
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+#else
+#define AllocationCounting 0
+#endif
+
+//Pipe====================================================================================================
+//========================================================================================================
+
+class Pipe final : public QIODevice
+{
+public:
+    qint64 written = 0;
+
+    void feed(const QByteArray & data, int chunk)
+    {
+        if(chunk <= 0) chunk = data.size();
+
+        for(qsizetype pos = 0; pos < data.size(); pos += chunk)
+        {
+            _in.append(data.constData() + pos, qMin<qsizetype>(chunk, data.size() - pos));
+            emit readyRead();
+        }
+    }
+
+    bool isSequential() const override
+    {
+        return true;
+    }
+
+    qint64 bytesAvailable() const override
+    {
+        return _in.size() - _offset + QIODevice::bytesAvailable();
+    }
+
+protected:
+    qint64 readData(char * data, qint64 maxSize) override
+    {
+        qint64 n = qMin<qint64>(maxSize, _in.size() - _offset);
+        std::memcpy(data, _in.constData() + _offset, n);
+        _offset += n;
+
+        if(_offset == _in.size())
+        {
+            _in.truncate(0);
+            _offset = 0;
+        }
+
+        return n;
+    }
+
+    qint64 writeData(const char *, qint64 size) override
+    {
+        written += size;
+        return size;
+    }
+
+private:
+    QByteArray _in;
+    qsizetype _offset = 0;
+};
+
+//Backend=================================================================================================
+//========================================================================================================
+
+struct ColumnShape
+{
+    QByteArray name, type;
+    quint32 oid = 0;
+    qint16 size = -1;
+    int length = 0;
+};
+
+class Backend
+{
+public:
+    QByteArray data;
+    qint64 messages = 0;
+
+    void message(char type, const QByteArray & body = QByteArray())
+    {
+        const quint32 size = qToBigEndian(quint32(sizeof (quint32) + body.size()));
+
+        data.append(type);
+        data.append(reinterpret_cast<const char *>(&size), sizeof (size));
+        data.append(body);
+        messages++;
+    }
+
+    void clear()
+    {
+        data.clear();
+        messages = 0;
+    }
+};
+
+template<typename T> static void appendBig(QByteArray & out, T value)
+{
+    value = qToBigEndian(value);
+    out.append(reinterpret_cast<const char *>(&value), sizeof (T));
+}
+
+static bool parseShape(const QString & spec, QVector<ColumnShape> & shape)
+{
+    static const struct { const char * name; quint32 oid; qint16 size; } types[] =
+    {
+        {"bool", 16, 1}, {"int2", 21, 2}, {"int4", 23, 4}, {"int8", 20, 8},
+        {"float4", 700, 4}, {"float8", 701, 8}, {"numeric", 1700, -1},
+        {"date", 1082, 4}, {"time", 1083, 8}, {"timestamp", 1114, 8}, {"timestamptz", 1184, 8},
+        {"uuid", 2950, 16}, {"text", 25, -1}, {"bytea", 17, -1}
+    };
+
+    for(const QString & item : spec.split(',', Qt::SkipEmptyParts))
+    {
+        const QStringList parts = item.trimmed().split(':');
+        ColumnShape column;
+        column.type = parts[0].toLatin1();
+        column.name = "c" + QByteArray::number(shape.size());
+        column.length = (parts.size() > 1) ? parts[1].toInt() : 16;
+
+        for(const auto & type : types)
+        {
+            if(column.type != type.name) continue;
+            column.oid = type.oid;
+            column.size = type.size;
+        }
+
+        if(column.oid == 0) return false;
+        shape.append(column);
+    }
+
+    return !shape.isEmpty();
+}
+
+static QByteArray rowDescription(const QVector<ColumnShape> & shape)
+{
+    QByteArray body;
+    appendBig<qint16>(body, shape.size());
+
+    for(const ColumnShape & column : shape)
+    {
+        body.append(column.name);
+        body.append(char(0));
+        appendBig<quint32>(body, 0);
+        appendBig<qint16>(body, 0);
+        appendBig<quint32>(body, column.oid);
+        appendBig<qint16>(body, column.size);
+        appendBig<qint32>(body, -1);
+        appendBig<qint16>(body, 1);
+    }
+
+    return body;
+}
+
+static void appendCell(QByteArray & out, const ColumnShape & column, qint64 row)
+{
+    const qsizetype start = out.size();
+    appendBig<qint32>(out, 0);
+
+    switch(column.oid)
+    {
+        case 16: out.append(char(row & 1));
+        break;
+        case 21: appendBig<qint16>(out, qint16(row));
+        break;
+        case 23: case 1082: appendBig<qint32>(out, qint32(row % 100000));
+        break;
+        case 20: appendBig<qint64>(out, row * 7919);
+        break;
+        case 700:
+        {
+            float value = row * 0.25f;
+            quint32 bits;
+            std::memcpy(&bits, &value, sizeof (bits));
+            appendBig<quint32>(out, bits);
+        }
+        break;
+        case 701:
+        {
+            double value = row * 0.125;
+            quint64 bits;
+            std::memcpy(&bits, &value, sizeof (bits));
+            appendBig<quint64>(out, bits);
+        }
+        break;
+        case 1700:
+        {
+            const qint16 digits[] = {qint16(row % 10000), 2345, 6700};
+            appendBig<qint16>(out, 3);
+            appendBig<qint16>(out, 1);
+            appendBig<quint16>(out, 0);
+            appendBig<qint16>(out, 2);
+            for(qint16 digit : digits) appendBig<qint16>(out, digit);
+        }
+        break;
+        case 1083: appendBig<qint64>(out, (row % 86400) * 1000000);
+        break;
+        case 1114: case 1184: appendBig<qint64>(out, 770000000000000 + row * 1000);
+        break;
+        case 2950:
+        {
+            appendBig<quint64>(out, 0x1b4da76328184aaeULL);
+            appendBig<quint64>(out, 0x874f2fc300000000ULL + quint64(row));
+        }
+        break;
+        default:
+        {
+            const qsizetype pos = out.size();
+            out.resize(pos + column.length);
+            for(int i = 0; i < column.length; i++) out[pos + i] = char('a' + (row + i) % 26);
+        }
+    }
+
+    const qint32 size = qToBigEndian(qint32(out.size() - start - sizeof (qint32)));
+    std::memcpy(out.data() + start, &size, sizeof (size));
+}
+
+static QVariant cellValue(const ColumnShape & column, qint64 row)
+{
+    switch(column.oid)
+    {
+        case 16: return bool(row & 1);
+        case 21: return QVariant::fromValue(qint16(row));
+        case 23: return int(row % 100000);
+        case 20: return row * 7919;
+        case 700: return row * 0.25f;
+        case 701: case 1700: return row * 0.125;
+        case 1082: return QDate(2000, 1, 1).addDays(row % 100000);
+        case 1083: return QTime(0, 0).addSecs(row % 86400);
+#if QT_VERSION >= 0x060500
+        case 1114: case 1184: return QDateTime::fromMSecsSinceEpoch(1716026804517 + row, QTimeZone::UTC);
+#else
+        case 1114: case 1184: return QDateTime::fromMSecsSinceEpoch(1716026804517 + row, Qt::UTC);
+#endif
+        case 2950: return QUuid(0x1b4da763, 0x2818, 0x4aae, 0x87, 0x4f, 0x2f, 0xc3, 0, 0, quint8(row >> 8), quint8(row));
+        case 17: return QByteArray(column.length, char('a' + row % 26));
+        default: return QString(column.length, QLatin1Char(char('a' + row % 26)));
+    }
+}
+
+//Bench===================================================================================================
+//========================================================================================================
+
+struct Measure
+{
+    qint64 nsecs = 0;
+    quint64 allocations = 0;
+};
+
+static Measure measure(int iterations, const std::function<void()> & prepare, const std::function<void()> & body)
+{
+    Measure best;
+
+    for(int i = 0; i < iterations; i++)
+    {
+        if(prepare) prepare();
+
+        QElapsedTimer timer;
+        const quint64 before = allocations.load(std::memory_order_relaxed);
+        timer.start();
+        body();
+        const qint64 nsecs = timer.nsecsElapsed();
+        const quint64 count = allocations.load(std::memory_order_relaxed) - before;
+
+        if(i == 0 || nsecs < best.nsecs) best = {nsecs, count};
+    }
+
+    return best;
+}
+
+static void report(const char * name, const Measure & m, const QList<QPair<const char *, double>> & values)
+{
+    std::printf("%-10s %12.3f ms", name, m.nsecs / 1e6);
+    for(const auto & value : values) std::printf("  %s=%.4g", value.first, value.second);
+    std::printf("\n");
+}
+
+static double perSecond(qint64 count, qint64 nsecs)
+{
+    return (nsecs > 0) ? count * 1e9 / nsecs : 0;
+}
+
+static double allocationsPer(quint64 allocations, qint64 count)
+{
+    return (AllocationCounting && count > 0) ? double(allocations) / count : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("TinyPG socket-free protocol and codec microbenchmarks");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"rows", "Rows in the synthetic result set.", "count", "100000"},
+        {"shape", "Comma separated column types, text and bytea take :length.", "types", "int4,int8,float8,text:16,timestamptz,uuid"},
+        {"chunk", "Bytes delivered per readyRead, 0 delivers the whole stream at once.", "bytes", "16384"},
+        {"iterations", "Repetitions per scenario, the best one is reported.", "count", "5"},
+        {"scenarios", "Comma separated list of parse, values, roundtrip, simple, bind.", "names", "parse,values,roundtrip,simple,bind"},
+    });
+    parser.process(a);
+
+    const int rows = qMax(1, parser.value("rows").toInt());
+    const int chunk = parser.value("chunk").toInt();
+    const int iterations = qMax(1, parser.value("iterations").toInt());
+    const QStringList scenarios = parser.value("scenarios").split(',', Qt::SkipEmptyParts);
+
+    QVector<ColumnShape> shape;
+
+    if(!parseShape(parser.value("shape"), shape))
+    {
+        std::fprintf(stderr, "Unknown column type in shape: %s\n", qPrintable(parser.value("shape")));
+        return 1;
+    }
+
+    const int columns = shape.size();
+    bool failed = false;
+
+    Pipe pipe;
+    pipe.open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+
+    TinyPG::Connection db;
+    db.connect(&db, &TinyPG::Connection::error, [&failed](const TinyPG::Message & error)
+    {
+        std::fprintf(stderr, "%s\n", qPrintable(error.message()));
+        failed = true;
+    });
+
+    db.connection(&pipe, "bench", "bench", "bench");
+
+    Backend backend;
+    QByteArray body;
+
+    appendBig<quint32>(body, 0);
+    backend.message('R', body);
+    backend.message('S', QByteArray("server_version\0" "16.0\0", 20));
+    body.clear();
+    appendBig<quint32>(body, 1);
+    appendBig<quint32>(body, 2);
+    backend.message('K', body);
+    backend.message('Z', "I");
+    pipe.feed(backend.data, 0);
+
+    if(failed || !db.isConnect()) return 1;
+
+    TinyPG::Query query(&db);
+    query.connect(&query, &TinyPG::Query::error, [&failed](const TinyPG::Message & error)
+    {
+        std::fprintf(stderr, "%s\n", qPrintable(error.message()));
+        failed = true;
+    });
+
+    const QByteArray description = rowDescription(shape);
+    const QByteArray complete = "SELECT " + QByteArray::number(rows) + '\0';
+
+    backend.clear();
+    backend.message('1');
+    backend.message('2');
+    backend.message('T', description);
+
+    for(int r = 0; r < rows; r++)
+    {
+        body.truncate(0);
+        appendBig<qint16>(body, columns);
+        for(const ColumnShape & column : shape) appendCell(body, column, r);
+        backend.message('D', body);
+    }
+
+    backend.message('C', complete);
+    backend.message('Z', "I");
+
+    const QByteArray result = backend.data;
+    const qint64 resultMessages = backend.messages;
+
+    std::printf("rows=%d columns=%d chunk=%d stream=%lld bytes iterations=%d allocation counting=%s\n",
+                rows, columns, chunk, qint64(result.size()), iterations, AllocationCounting ? "on" : "off");
+
+    if(scenarios.contains("parse") || scenarios.contains("values"))
+    {
+        auto m = measure(iterations, [&]()
+        {
+            query.exec("select");
+        },
+        [&]()
+        {
+            pipe.feed(result, chunk);
+        });
+
+        if(failed || query.rowCount() != rows) return 1;
+
+        if(scenarios.contains("parse"))
+        {
+            report("parse", m, {{"msgs/s", perSecond(resultMessages, m.nsecs)},
+                                {"rows/s", perSecond(rows, m.nsecs)},
+                                {"MB/s", perSecond(result.size(), m.nsecs) / 1e6},
+                                {"allocs/row", allocationsPer(m.allocations, rows)}});
+        }
+    }
+
+    if(scenarios.contains("values"))
+    {
+        qint64 sink = 0;
+        auto m = measure(iterations, nullptr, [&]()
+        {
+            for(int r = 0; r < rows; r++)
+                for(int c = 0; c < columns; c++) sink += query.value(r, c).isValid();
+        });
+
+        if(sink != qint64(rows) * columns * iterations) return 1;
+
+        const qint64 cells = qint64(rows) * columns;
+        report("values", m, {{"ns/cell", double(m.nsecs) / cells},
+                             {"cells/s", perSecond(cells, m.nsecs)},
+                             {"allocs/row", allocationsPer(m.allocations, rows)}});
+    }
+
+    const int queries = qMax(1, rows / 10);
+
+    if(scenarios.contains("roundtrip"))
+    {
+        backend.clear();
+        backend.message('1');
+        backend.message('2');
+        backend.message('T', description);
+        body.truncate(0);
+        appendBig<qint16>(body, columns);
+        for(const ColumnShape & column : shape) appendCell(body, column, 1);
+        backend.message('D', body);
+        backend.message('C', QByteArray("SELECT 1\0", 9));
+        backend.message('Z', "I");
+
+        const QByteArray response = backend.data;
+
+        auto m = measure(iterations, nullptr, [&]()
+        {
+            for(int i = 0; i < queries; i++)
+            {
+                query.exec("select");
+                pipe.feed(response, chunk);
+            }
+        });
+
+        if(failed) return 1;
+
+        report("roundtrip", m, {{"queries/s", perSecond(queries, m.nsecs)},
+                                {"msgs/s", perSecond(qint64(queries) * backend.messages, m.nsecs)},
+                                {"allocs/query", allocationsPer(m.allocations, queries)}});
+    }
+
+    backend.clear();
+    backend.message('1');
+    backend.message('2');
+    backend.message('n');
+    backend.message('C', QByteArray("INSERT 0 1\0", 11));
+    backend.message('Z', "I");
+
+    const QByteArray inserted = backend.data;
+
+    if(scenarios.contains("simple"))
+    {
+        QStringList statements;
+
+        for(int i = 0; i < 64; i++)
+        {
+            QStringList values;
+            for(const ColumnShape & column : shape) values.append("'" + cellValue(column, i).toString() + "'::" + QString::fromLatin1(column.type));
+            statements.append("insert into bench values(" + values.join(',') + ")");
+        }
+
+        Measure m;
+
+        for(int k = 0; k < iterations; k++)
+        {
+            Measure run;
+
+            for(int i = 0; i < queries; i++)
+            {
+                const quint64 before = allocations.load(std::memory_order_relaxed);
+                QElapsedTimer timer;
+                timer.start();
+                query.exec(statements[i % statements.size()]);
+                run.nsecs += timer.nsecsElapsed();
+                run.allocations += allocations.load(std::memory_order_relaxed) - before;
+
+                pipe.feed(inserted, 0);
+            }
+
+            if(k == 0 || run.nsecs < m.nsecs) m = run;
+        }
+
+        if(failed) return 1;
+
+        report("simple", m, {{"queries/s", perSecond(queries, m.nsecs)},
+                             {"ns/query", double(m.nsecs) / queries},
+                             {"allocs/query", allocationsPer(m.allocations, queries)}});
+    }
+
+    if(scenarios.contains("bind"))
+    {
+        QStringList placeholders;
+        for(int c = 0; c < columns; c++) placeholders.append("$" + QString::number(c + 1));
+
+        query.prepare("insert into bench values(" + placeholders.join(',') + ")");
+
+        backend.clear();
+        backend.message('1');
+        body.truncate(0);
+        appendBig<qint16>(body, columns);
+        for(const ColumnShape & column : shape) appendBig<quint32>(body, column.oid);
+        backend.message('t', body);
+        backend.message('n');
+        backend.message('Z', "I");
+        pipe.feed(backend.data, 0);
+
+        if(failed) return 1;
+
+        backend.clear();
+        backend.message('2');
+        backend.message('C', QByteArray("INSERT 0 1\0", 11));
+        backend.message('Z', "I");
+
+        const QByteArray bound = backend.data;
+        QVector<QVariantList> values;
+
+        for(int i = 0; i < 64; i++)
+        {
+            QVariantList row;
+            for(const ColumnShape & column : shape) row.append(cellValue(column, i));
+            values.append(row);
+        }
+
+        Measure m;
+
+        for(int k = 0; k < iterations; k++)
+        {
+            Measure run;
+
+            for(int i = 0; i < queries; i++)
+            {
+                const QVariantList & row = values[i % values.size()];
+                const quint64 before = allocations.load(std::memory_order_relaxed);
+                QElapsedTimer timer;
+                timer.start();
+                for(int c = 0; c < columns; c++) query.bindValue(c, row[c]);
+                query.exec();
+                run.nsecs += timer.nsecsElapsed();
+                run.allocations += allocations.load(std::memory_order_relaxed) - before;
+
+                pipe.feed(bound, 0);
+            }
+
+            if(k == 0 || run.nsecs < m.nsecs) m = run;
+        }
+
+        if(failed) return 1;
+
+        report("bind", m, {{"queries/s", perSecond(queries, m.nsecs)},
+                           {"ns/query", double(m.nsecs) / queries},
+                           {"allocs/query", allocationsPer(m.allocations, queries)}});
+    }
+
+    std::printf("driver wrote %lld bytes\n", pipe.written);
+    return 0;
+}
@@ -0,0 +1,430 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSet>
+#include <QThread>
+#include <QtEndian>
+#include "TinyPG.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define ProtocolVersion3 0x00030000
+#define MinimumPackageSize 0x05
+
+struct Frame
+{
+    char direction = 0;
+    qint64 nsecs = 0;
+    QByteArray data;
+};
+
+//Pipe====================================================================================================
+//========================================================================================================
+
+class Pipe final : public QIODevice
+{
+public:
+    void feed(const QByteArray & data)
+    {
+        _in.append(data);
+        emit readyRead();
+    }
+
+    bool isSequential() const override
+    {
+        return true;
+    }
+
+    qint64 bytesAvailable() const override
+    {
+        return _in.size() - _offset + QIODevice::bytesAvailable();
+    }
+
+protected:
+    qint64 readData(char * data, qint64 maxSize) override
+    {
+        qint64 n = qMin<qint64>(maxSize, _in.size() - _offset);
+        std::memcpy(data, _in.constData() + _offset, n);
+        _offset += n;
+
+        if(_offset == _in.size())
+        {
+            _in.truncate(0);
+            _offset = 0;
+        }
+
+        return n;
+    }
+
+    qint64 writeData(const char *, qint64 size) override
+    {
+        return size;
+    }
+
+private:
+    QByteArray _in;
+    qsizetype _offset = 0;
+};
+
+//Replayer================================================================================================
+//========================================================================================================
+
+class Replayer
+{
+public:
+    explicit Replayer(TinyPG::Connection * db) : _db(db){}
+
+    int prepared = 0, executed = 0, skipped = 0;
+
+    void frontend(const QByteArray & data);
+
+private:
+    TinyPG::Connection * _db;
+    QByteArray _buffer;
+    bool _started = false;
+
+    QByteArray _unnamedSql, _bindStatement;
+    QVector<QByteArray> _parameters;
+    bool _bindPending = false, _bindValid = false;
+
+    QHash<TinyPG::Query *, QVector<QByteArray>> _deferred;
+
+    QHash<QByteArray, TinyPG::Query *> _statements;
+    QVector<TinyPG::Query *> _simple;
+    QSet<TinyPG::Query *> _busy;
+    TinyPG::Query * _portal = nullptr;
+
+    TinyPG::Query * idle();
+    TinyPG::Query * create();
+    void message(char type, const char * body, quint32 size);
+};
+
+TinyPG::Query * Replayer::create()
+{
+    TinyPG::Query * query = new TinyPG::Query(_db, _db);
+    query->connect(query, &TinyPG::Query::executeFinished, [this, query]() { _busy.remove(query); });
+    query->connect(query, &TinyPG::Query::error, [this, query](const TinyPG::Message &) { _busy.remove(query); _deferred.remove(query); });
+    query->connect(query, &TinyPG::Query::prepareFinished, [this, query]()
+    {
+        if(!_deferred.contains(query))
+        {
+           _busy.remove(query);
+           return;
+        }
+
+        const QVector<QByteArray> parameters = _deferred.take(query);
+        for(int i = 0; i < parameters.size(); i++) query->bindEncoded(i, parameters[i]);
+        query->exec();
+    });
+
+    return query;
+}
+
+static const char * skipString(const char * p, const char * end)
+{
+    const void * zero = (p < end) ? std::memchr(p, 0, end - p) : nullptr;
+    return (zero == nullptr) ? nullptr : static_cast<const char *>(zero) + 1;
+}
+
+TinyPG::Query * Replayer::idle()
+{
+    for(TinyPG::Query * query : std::as_const(_simple))
+    {
+        if(!_busy.contains(query) && !query->canFetchMore()) return query;
+    }
+
+    _simple.append(create());
+    return _simple.last();
+}
+
+void Replayer::frontend(const QByteArray & data)
+{
+    _buffer.append(data);
+    qsizetype pos = 0;
+
+    while(true)
+    {
+        if(!_started)
+        {
+           if(_buffer.size() - pos < 8) break;
+
+           const quint32 length = qFromBigEndian<quint32>(_buffer.constData() + pos);
+           if(_buffer.size() - pos < length) break;
+
+           _started = qFromBigEndian<quint32>(_buffer.constData() + pos + sizeof (quint32)) == ProtocolVersion3;
+           pos += length;
+           continue;
+        }
+
+        if(_buffer.size() - pos < MinimumPackageSize) break;
+
+        const quint32 length = qFromBigEndian<quint32>(_buffer.constData() + pos + 1);
+        if(_buffer.size() - pos <= length) break;
+
+        message(_buffer[pos], _buffer.constData() + pos + MinimumPackageSize, length - sizeof (quint32));
+        pos += length + 1;
+    }
+
+    _buffer.remove(0, pos);
+}
+
+void Replayer::message(char type, const char * body, quint32 size)
+{
+    switch(type)
+    {
+        case 'P':
+        {
+            const QByteArray name(body);
+            const QByteArray sql(body + name.size() + 1);
+
+            if(name.isEmpty())
+            {
+               _unnamedSql = sql;
+               return;
+            }
+
+            TinyPG::Query *& query = _statements[name];
+            if(query == nullptr) query = create();
+
+            _busy.insert(query);
+            query->prepare(QString::fromUtf8(sql));
+            prepared++;
+        }
+        break;
+        case 'B':
+        {
+            const char * end = body + size;
+            const char * name = skipString(body, end);
+            const char * p = (name == nullptr) ? nullptr : skipString(name, end);
+
+            _bindPending = true;
+            _bindValid = false;
+
+            if(p == nullptr || end - p < qint64(sizeof (quint16))) return;
+            _bindStatement = QByteArray(name, p - name - 1);
+
+            const qint64 formats = qFromBigEndian<quint16>(p);
+            if(end - p < (formats + 2) * qint64(sizeof (quint16))) return;
+            p += (formats + 1) * sizeof (quint16);
+
+            const int count = qFromBigEndian<quint16>(p);
+            p += sizeof (quint16);
+
+            _parameters.resize(count);
+
+            for(int i = 0; i < count; i++)
+            {
+                if(end - p < qint64(sizeof (qint32))) return;
+
+                const qint32 length = qFromBigEndian<qint32>(p);
+                p += sizeof (qint32);
+
+                if(length > end - p) return;
+
+                _parameters[i] = (length < 0) ? QByteArray() : QByteArray(p, length);
+                if(length > 0) p += length;
+            }
+
+            _bindValid = true;
+        }
+        break;
+        case 'E':
+        {
+            const int rows = qFromBigEndian<qint32>(body + std::strlen(body) + 1);
+
+            if(!_bindPending)
+            {
+               if(_portal != nullptr) _portal->fetchMore();
+               return;
+            }
+
+            _bindPending = false;
+            TinyPG::Query * query = !_bindValid ? nullptr : _bindStatement.isEmpty() ? idle() : _statements.value(_bindStatement);
+
+            if(query == nullptr)
+            {
+               skipped++;
+               return;
+            }
+
+            query->setFetchSize(rows);
+            _busy.insert(query);
+
+            if(_bindStatement.isEmpty() && _parameters.isEmpty()) query->exec(QString::fromUtf8(_unnamedSql));
+            else if(_bindStatement.isEmpty())
+            {
+               _deferred.insert(query, _parameters);
+               query->prepare(QString::fromUtf8(_unnamedSql));
+            }
+            else
+            {
+               for(int i = 0; i < _parameters.size(); i++) query->bindEncoded(i, _parameters[i]);
+               query->exec();
+            }
+
+            if(rows > 0) _portal = query;
+            executed++;
+        }
+        break;
+        case 'C':
+        {
+            if(body[0] == 'P' && _portal != nullptr) _portal->closePortal();
+        }
+        break;
+    }
+}
+
+//Replay==================================================================================================
+//========================================================================================================
+
+static bool readCapture(const QString & path, qint64 & epoch, QVector<Frame> & frames)
+{
+    QFile file(path);
+
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        std::fprintf(stderr, "%s: %s\n", qPrintable(path), qPrintable(file.errorString()));
+        return false;
+    }
+
+    const QByteArray data = file.readAll();
+    const qsizetype header = sizeof (TinyPG::CaptureMagic) - 1 + sizeof (qint64);
+
+    if(data.size() < header || std::memcmp(data.constData(), TinyPG::CaptureMagic, sizeof (TinyPG::CaptureMagic) - 1) != 0)
+    {
+        std::fprintf(stderr, "%s: not a TinyPG capture\n", qPrintable(path));
+        return false;
+    }
+
+    epoch = qFromBigEndian<qint64>(data.constData() + sizeof (TinyPG::CaptureMagic) - 1);
+    qsizetype pos = header;
+
+    while(data.size() - pos >= TinyPG::CaptureFrameSize)
+    {
+        Frame frame;
+        frame.direction = data[pos];
+        frame.nsecs = qFromBigEndian<qint64>(data.constData() + pos + 1);
+        const quint32 length = qFromBigEndian<quint32>(data.constData() + pos + 1 + sizeof (qint64));
+        pos += TinyPG::CaptureFrameSize;
+
+        if(data.size() - pos < length) break;
+
+        frame.data = data.mid(pos, length);
+        pos += length;
+        frames.append(frame);
+    }
+
+    if(pos != data.size()) std::fprintf(stderr, "%s: truncated after %lld frames\n", qPrintable(path), qint64(frames.size()));
+    return true;
+}
+
+static void countMessages(const QVector<Frame> & frames, qint64 & messages, qint64 & rows)
+{
+    QByteArray stream;
+    for(const Frame & frame : frames) if(frame.direction == TinyPG::CaptureRead) stream.append(frame.data);
+
+    for(qsizetype pos = 0; stream.size() - pos >= MinimumPackageSize; pos += qFromBigEndian<quint32>(stream.constData() + pos + 1) + 1)
+    {
+        messages++;
+        if(stream[pos] == 'D') rows++;
+    }
+}
+
+static void waitUntil(const QElapsedTimer & clock, qint64 nsecs)
+{
+    const qint64 left = nsecs - clock.nsecsElapsed();
+    if(left > 2000000) QThread::usleep((left - 1000000) / 1000);
+    while(clock.nsecsElapsed() < nsecs){}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a TinyPG wire capture through the protocol parser");
+    parser.addHelpOption();
+    parser.addPositionalArgument("capture", "Capture file written through Connection::setCapture.");
+    parser.addOptions({
+        {"speed", "original keeps the captured timing, max feeds frames back to back.", "mode", "max"},
+        {"iterations", "Replays of the capture, the fastest one is reported.", "count", "1"},
+    });
+    parser.process(a);
+
+    if(parser.positionalArguments().size() != 1) parser.showHelp(1);
+
+    const bool original = parser.value("speed") == "original";
+    const int iterations = qMax(1, parser.value("iterations").toInt());
+
+    qint64 epoch = 0;
+    QVector<Frame> frames;
+    if(!readCapture(parser.positionalArguments().first(), epoch, frames)) return 1;
+
+    qint64 messages = 0, rows = 0, bytesIn = 0, bytesOut = 0;
+    countMessages(frames, messages, rows);
+
+    for(const Frame & frame : std::as_const(frames)) ((frame.direction == TinyPG::CaptureRead) ? bytesIn : bytesOut) += frame.data.size();
+
+    const qint64 captured = frames.isEmpty() ? 0 : frames.last().nsecs;
+
+#if QT_VERSION >= 0x060500
+    const QDateTime started = QDateTime::fromMSecsSinceEpoch(epoch, QTimeZone::UTC);
+#else
+    const QDateTime started = QDateTime::fromMSecsSinceEpoch(epoch, Qt::UTC);
+#endif
+
+    std::printf("capture started %s, %.3f s, %lld frames, %lld bytes in, %lld bytes out, %lld messages, %lld rows\n",
+                qPrintable(started.toString(Qt::ISODateWithMs)), captured / 1e9,
+                qint64(frames.size()), bytesIn, bytesOut, messages, rows);
+
+    qint64 best = -1;
+    int errors = 0;
+
+    for(int i = 0; i < iterations; i++)
+    {
+        Pipe pipe;
+        pipe.open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+
+        TinyPG::Connection db;
+        db.connect(&db, &TinyPG::Connection::error, [&errors](const TinyPG::Message & error)
+        {
+            if(errors++ == 0) std::fprintf(stderr, "%s\n", qPrintable(error.message()));
+        });
+
+        db.connection(&pipe, "replay", "replay", "replay");
+
+        Replayer replayer(&db);
+        QElapsedTimer clock, timer;
+        qint64 parse = 0;
+        clock.start();
+
+        for(const Frame & frame : std::as_const(frames))
+        {
+            if(frame.direction != TinyPG::CaptureRead)
+            {
+               replayer.frontend(frame.data);
+               continue;
+            }
+
+            if(original) waitUntil(clock, frame.nsecs);
+
+            timer.start();
+            pipe.feed(frame.data);
+            parse += timer.nsecsElapsed();
+        }
+
+        if(best < 0 || parse < best) best = parse;
+
+        std::printf("replay %d: %.3f s wall, %.3f ms parsing, %d prepared, %d executed, %d skipped\n", i + 1,
+                    clock.nsecsElapsed() / 1e9, parse / 1e6, replayer.prepared, replayer.executed, replayer.skipped);
+    }
+
+    const double seconds = qMax<qint64>(best, 1) / 1e9;
+    std::printf("best parse %.3f ms: %.0f msgs/s, %.0f rows/s, %.1f MB/s\n", best / 1e6,
+                messages / seconds, rows / seconds, bytesIn / seconds / 1e6);
+
+    return errors > 0 ? 2 : 0;
+}